@@ -7,6 +7,7 @@
 #include "mednafen/psx/dis.cpp"
 #include "mednafen/psx/cdc.cpp"
 #include "mednafen/psx/spu.cpp"
+#include "mednafen/psx/resampler.cpp"
 #include "mednafen/psx/gpu.cpp"
 #include "mednafen/psx/mdec.cpp"
 #include "mednafen/psx/input/gamepad.cpp"
@@ -24,6 +25,7 @@
 #include "mednafen/general.cpp"
 #include "mednafen/FileStream.cpp"
 #include "mednafen/MemoryStream.cpp"
+#include "mednafen/MMapStream.cpp"
 #include "mednafen/Stream.cpp"
 #include "mednafen/state.cpp"
 
@@ -36,10 +38,10 @@
 #include "mednafen/cdrom/audioreader.cpp"
 #include "mednafen/cdrom/cdromif.cpp"
 #include "mednafen/cdrom/misc.cpp"
+#include "mednafen/cdrom/SubQTable.cpp"
 #endif
 
 #include "mednafen/mempatcher.cpp"
-#include "mednafen/video/Deinterlacer.cpp"
 #include "mednafen/video/surface.cpp"
 
 #include "libretro.cpp"
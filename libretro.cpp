@@ -5,9 +5,6 @@
 #include "mednafen/md5.h"
 #include <compat/msvc.h>
 #include "mednafen/psx/gpu.h"
-#ifdef NEED_DEINTERLACER
-#include "mednafen/video/Deinterlacer.h"
-#endif
 #include <libretro.h>
 #include <rthreads/rthreads.h>
 #include <streams/file_stream.h>
@@ -56,6 +53,10 @@ static bool gui_show = false;
 
 unsigned cd_2x_speedup = 1;
 bool cd_async = false;
+unsigned cd_chd_cache_hunks = 32;
+unsigned cd_chd_prefetch_threads = 1;
+unsigned cd_pbp_cache_blocks = 32;
+unsigned cd_pbp_prefetch_threads = 1;
 bool cd_warned_slow = false;
 int64 cd_slow_timeout = 8000; // microseconds
 
@@ -265,6 +266,7 @@ static void extract_directory(char *buf, const char *path, size_t size)
 #include "mednafen/psx/sio.h"
 #include "mednafen/psx/cdc.h"
 #include "mednafen/psx/spu.h"
+#include "mednafen/psx/resampler.h"
 #include "mednafen/mempatcher.h"
 
 #include <stdarg.h>
@@ -708,6 +710,11 @@ template<typename T, bool IsWrite, bool Access24> static INLINE void MemRW(int32
          if(!IsWrite)
             timestamp++;
 
+         // The GPU only schedules events on the scanlines that matter
+         // when idle, catch it up before it's observed; GPU_Write()
+         // reschedules itself if the write changes the line timing.
+         GPU_Sync(timestamp);
+
          if(IsWrite)
             GPU_Write(timestamp, A, V);
          else
@@ -834,7 +841,12 @@ template<typename T, bool IsWrite, bool Access24> static INLINE void MemRW(int32
             timestamp++;
 
          if(IsWrite)
+         {
+            // A counter may start following the GPU lines
+            GPU_Sync(timestamp);
             TIMER_Write(timestamp, A, V);
+            GPU_Sync(timestamp);
+         }
          else
             V = TIMER_Read(timestamp, A);
 
@@ -1178,7 +1190,12 @@ void PSX_MemPoke32(uint32 A, uint32 V)
    MemPoke<uint32, false>(0, A, V);
 }
 
-void PSX_GPULineHook(const int32_t timestamp, const int32_t line_timestamp, bool vsync, uint32_t *pixels, const MDFN_PixelFormat* const format, const unsigned width, const unsigned pix_clock_offset, const unsigned pix_clock, const unsigned pix_clock_divider)
+bool PSX_GPULineHookTimed(void)
+{
+   return FIO && FIO->RequireNoFrameskip();
+}
+
+void PSX_GPULineHook(const int32_t timestamp, const int32_t line_timestamp, bool vsync, MDFN_SurfacePixel *pixels, const MDFN_PixelFormat* const format, const unsigned width, const unsigned pix_clock_offset, const unsigned pix_clock, const unsigned pix_clock_divider)
 {
    FIO->GPULineHook(timestamp, line_timestamp, vsync, pixels, format, width, pix_clock_offset, pix_clock, pix_clock_divider);
 }
@@ -2397,18 +2414,17 @@ extern void Emulate(EmulateSpecStruct *espec);
 static bool overscan;
 static double last_sound_rate;
 
-#ifdef NEED_DEINTERLACER
-static bool PrevInterlaced;
-static Deinterlacer deint;
-#endif
-
 static MDFN_Surface *surf = NULL;
 
+/* The surface starts out sized for the most common display mode (320
+ * pixels plus overscan, progressive) and is grown by the GPU when a
+ * wider or interlaced mode is displayed. */
 static void alloc_surface(void)
 {
-   MDFN_PixelFormat pix_fmt(MDFN_COLORSPACE_RGB, 16, 8, 0, 24);
-   uint32_t width  = MEDNAFEN_CORE_GEOMETRY_MAX_W;
-   uint32_t height = is_pal ? MEDNAFEN_CORE_GEOMETRY_MAX_H  : 480;
+   MDFN_PixelFormat pix_fmt(MDFN_COLORSPACE_RGB, RED_SHIFT, GREEN_SHIFT, BLUE_SHIFT, ALPHA_SHIFT,
+         sizeof(MDFN_SurfacePixel) * 8);
+   uint32_t width  = 350;
+   uint32_t height = is_pal ? 288 : 240;
 
    width  <<= GPU_get_upscale_shift();
    height <<= GPU_get_upscale_shift();
@@ -2416,7 +2432,7 @@ static void alloc_surface(void)
    if (surf != NULL)
       delete surf;
 
-   surf = new MDFN_Surface(NULL, width, height, width, pix_fmt);
+   surf = new MDFN_Surface(NULL, width, height, (width + 15) & ~15, pix_fmt);
 }
 
 static void check_system_specs(void)
@@ -2651,6 +2667,23 @@ static bool shared_memorycards_toggle = false;
 
 static bool has_new_geometry = false;
 
+// Output rate picked in the core options; audio_output_rate is the one the
+// frontend was last told about.
+static unsigned audio_output_rate_setting = SOUND_FREQUENCY;
+
+static void apply_audio_output_rate(void)
+{
+   bool resample = audio_output_rate != SOUND_FREQUENCY && Resampler_Init(audio_output_rate);
+
+   if (!resample)
+   {
+      Resampler_Kill();
+      audio_output_rate = SOUND_FREQUENCY;
+   }
+
+   IntermediateBufferHeadroom = !resample;
+}
+
 static void check_variables(bool startup)
 {
    struct retro_variable var = {0};
@@ -2680,6 +2713,36 @@ static void check_variables(bool startup)
    }
 #endif
 
+   var.key = BEETLE_OPT(cd_chd_cache);
+
+   if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value)
+      cd_chd_cache_hunks = atoi(var.value);
+
+   var.key = BEETLE_OPT(cd_chd_prefetch);
+
+   if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value)
+   {
+      if (strcmp(var.value, "disabled") == 0)
+         cd_chd_prefetch_threads = 0;
+      else
+         cd_chd_prefetch_threads = atoi(var.value);
+   }
+
+   var.key = BEETLE_OPT(cd_pbp_cache);
+
+   if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value)
+      cd_pbp_cache_blocks = atoi(var.value);
+
+   var.key = BEETLE_OPT(cd_pbp_prefetch);
+
+   if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value)
+   {
+      if (strcmp(var.value, "disabled") == 0)
+         cd_pbp_prefetch_threads = 0;
+      else
+         cd_pbp_prefetch_threads = atoi(var.value);
+   }
+
    var.key = BEETLE_OPT(cpu_freq_scale);
 
    if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value)
@@ -3175,6 +3238,19 @@ static void check_variables(bool startup)
          image_crop = 8;
    }
 
+   var.key = BEETLE_OPT(audio_output_rate);
+
+   if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value)
+      audio_output_rate_setting = strtoul(var.value, NULL, 10);
+   else
+      audio_output_rate_setting = SOUND_FREQUENCY;
+
+   if (!audio_output_rate_setting)
+      audio_output_rate_setting = SOUND_FREQUENCY;
+
+   if (startup)
+      audio_output_rate = audio_output_rate_setting;
+
    var.key = BEETLE_OPT(cd_fastload);
 
    if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value)
@@ -3426,7 +3502,15 @@ bool retro_load_game(const struct retro_game_info *info)
 
 	input_init_env( environ_cb );
 
+#if defined(WANT_16BPP)
+#if !defined(FRONTEND_SUPPORTS_RGB565)
+#error "16bpp output needs FRONTEND_SUPPORTS_RGB565"
+#endif
+   /* The software renderer scans out straight to RGB565 */
+   enum retro_pixel_format fmt = RETRO_PIXEL_FORMAT_RGB565;
+#else
    enum retro_pixel_format fmt = RETRO_PIXEL_FORMAT_XRGB8888;
+#endif
    if (!environ_cb(RETRO_ENVIRONMENT_SET_PIXEL_FORMAT, &fmt))
       return false;
 
@@ -3441,6 +3525,7 @@ bool retro_load_game(const struct retro_game_info *info)
       snprintf(retro_cd_path, sizeof(retro_cd_path), "%s", info->path);
 
    check_variables(true);
+   apply_audio_output_rate();
    //make sure shared memory cards and save states are enabled only at startup
    shared_memorycards = shared_memorycards_toggle;
 
@@ -3468,11 +3553,6 @@ bool retro_load_game(const struct retro_game_info *info)
 
    alloc_surface();
 
-#ifdef NEED_DEINTERLACER
-   PrevInterlaced = false;
-   deint.ClearState();
-#endif
-
 	input_init();
 
    boot = false;
@@ -3492,6 +3572,9 @@ void retro_unload_game(void)
 
    rsx_intf_close();
 
+   Resampler_Kill();
+   IntermediateBufferHeadroom = true;
+
    MDFN_FlushGameCheats(0);
 
    CloseGame();
@@ -3531,7 +3614,8 @@ void retro_run(void)
    if (gui_show && gui_inited && frame_width > 0 && frame_height > 0)
    {
       gui_draw();
-      video_cb(gui_get_framebuffer(), frame_width, frame_height, frame_width * sizeof(unsigned));
+      video_cb(gui_get_framebuffer(), frame_width, frame_height, frame_width * sizeof(MDFN_SurfacePixel));
+      GPU_InvalidateScanout();
    }
 #endif
 
@@ -3561,6 +3645,19 @@ void retro_run(void)
          }
       }
 
+      /* Output rate changed, need to call SET_SYSTEM_AV_INFO */
+      if (audio_output_rate != audio_output_rate_setting)
+      {
+         unsigned old_rate = audio_output_rate;
+
+         audio_output_rate = audio_output_rate_setting;
+         retro_get_system_av_info(&new_av_info);
+         if (environ_cb(RETRO_ENVIRONMENT_SET_SYSTEM_AV_INFO, &new_av_info))
+            apply_audio_output_rate();
+         else
+            audio_output_rate = old_rate;
+      }
+
       /* Widescreen hack changed, need to call SET_GEOMETRY to change aspect ratio */
       if (has_new_geometry)
       {
@@ -3585,6 +3682,9 @@ void retro_run(void)
       }
 
       PGXP_SetModes(psx_pgxp_mode | psx_pgxp_vertex_caching | psx_pgxp_texture_correction);
+
+      /* Cropping or scaling may have changed, don't dupe the next frame */
+      GPU_InvalidateScanout();
    }
 
    /* We only start counting after the first frame we encounter. This
@@ -3659,6 +3759,10 @@ void retro_run(void)
    espec->SoundBufSize = 0;
 
    FIO->UpdateInput();
+
+   /* Lightgun crosshairs are drawn over the output lines, they must
+    * be converted again every frame */
+   GPU_set_scanout_skip(allow_frame_duping && !FIO->RequireNoFrameskip());
    GPU_StartFrame(espec);
 
    Running = -1;
@@ -3667,6 +3771,7 @@ void retro_run(void)
    assert(timestamp);
 
    ForceEventUpdates(timestamp);
+   SPU->Sync();
 #if 0
    if(GPU_GetScanlineNum() < 100)
       PSX_DBG(PSX_DBG_ERROR, "[BUUUUUUUG] Frame timing end glitch; scanline=%u, st=%u\n", GPU_GetScanlineNum(), timestamp);
@@ -3735,22 +3840,11 @@ void retro_run(void)
 
    if (rsx_intf_is_type() == RSX_SOFTWARE)
    {
-#ifdef NEED_DEINTERLACER
-      if (spec.InterlaceOn)
-      {
-         if (!PrevInterlaced)
-            deint.ClearState();
-
-         deint.Process(spec.surface, spec.DisplayRect, spec.LineWidths, spec.InterlaceField);
+      /* Interlaced fields are woven (or bobbed) by the GPU as they
+       * are scanned out, the surface always holds a full frame. */
+      spec.InterlaceOn    = false;
+      spec.InterlaceField = 0;
 
-         PrevInterlaced = true;
-
-         spec.InterlaceOn = false;
-         spec.InterlaceField = 0;
-      }
-      else
-         PrevInterlaced = false;
-#endif
       // PSX is rather special, and needs specific handling ...
 
       width = rects[0]; // spec.DisplayRect.w is 0. Only rects[0].w seems to return something sane.
@@ -3758,8 +3852,9 @@ void retro_run(void)
       //fprintf(stderr, "(%u x %u)\n", width, height);
       // PSX core inserts padding on left and right (overscan). Optionally crop this.
 
-      const uint32_t *pix = surf->pixels;
+      const MDFN_SurfacePixel *pix = (const MDFN_SurfacePixel*)surf->pixels;
       unsigned pix_offset = 0;
+      unsigned pix_lines  = 0;
 
       if (crop_overscan)
       {
@@ -3808,19 +3903,18 @@ void retro_run(void)
             // These numbers are arbitrary since the bars differ some by game.
             // Changes aspect ratio in the process.
             height -= 36;
-            pix_offset += 5 * (MEDNAFEN_CORE_GEOMETRY_MAX_W << 2);
+            pix_lines  = 20;
          }
       }
 
 
       width  <<= upscale_shift;
       height <<= upscale_shift;
-      pix     += pix_offset << upscale_shift;
-
-      if (GPU_get_display_change_count() != 0)
-         fb = pix;
+      pix     += (pix_offset << upscale_shift) + pix_lines * surf->pitchinpix;
 
-      if (!allow_frame_duping)
+      /* Dupe the previous frame when nothing in the displayed
+       * area of VRAM has changed */
+      if (!allow_frame_duping || GPU_get_scanout_changed())
          fb = pix;
    }
 
@@ -3833,7 +3927,7 @@ void retro_run(void)
          frame_width = width;
          frame_height = height;
 
-         gui_init(frame_width, frame_height, sizeof(unsigned));
+         gui_init(frame_width, frame_height, sizeof(MDFN_SurfacePixel));
          gui_set_window_title("Error");
          gui_inited = true;
       }
@@ -3848,14 +3942,21 @@ void retro_run(void)
    else
 #endif
    {
-      rsx_intf_finalize_frame(fb, width, height,
-            MEDNAFEN_CORE_GEOMETRY_MAX_W << (2 + upscale_shift));
+      rsx_intf_finalize_frame(fb, width, height, surf->pitchinpix * sizeof(MDFN_SurfacePixel));
    }
 
    video_frames++;
    audio_frames += spec.SoundBufSize;
 
-   audio_batch_cb(interbuf, spec.SoundBufSize);
+   if (!IntermediateBufferHeadroom)
+   {
+      int16_t *resampled;
+      unsigned frames = Resampler_Process(interbuf, spec.SoundBufSize, &resampled);
+
+      audio_batch_cb(resampled, frames);
+   }
+   else
+      audio_batch_cb(interbuf, spec.SoundBufSize);
 
    if (GPU_get_display_change_count() != 0)
    {
@@ -3970,9 +4071,14 @@ void retro_set_environment(retro_environment_t cb)
 #ifndef EMSCRIPTEN
       { BEETLE_OPT(cd_access_method), "CD Access Method (restart); sync|async|precache" },
 #endif
+      { BEETLE_OPT(cd_chd_cache), "CHD hunk cache (restart); 32|16|64|128|256|1" },
+      { BEETLE_OPT(cd_chd_prefetch), "CHD background decompression threads (restart); 1|2|4|disabled" },
+      { BEETLE_OPT(cd_pbp_cache), "PBP block cache (restart); 32|16|64|128|1" },
+      { BEETLE_OPT(cd_pbp_prefetch), "PBP background decompression threads (restart); 1|2|4|disabled" },
       { BEETLE_OPT(use_mednafen_memcard0_method), "Memcard 0 method; libretro|mednafen" },
       { BEETLE_OPT(enable_memcard1), "Enable memory card 1; enabled|disabled" },
       { BEETLE_OPT(shared_memory_cards), "Shared memcards (restart); disabled|enabled" },
+      { BEETLE_OPT(audio_output_rate), "Audio output rate (Hz); 44100 (native)|48000|96000|32000|22050" },
       { BEETLE_OPT(cd_fastload), "Increase CD loading speed; 2x (native)|4x|6x|8x|10x|12x|14x" },
       { NULL, NULL },
    };
@@ -10,3 +10,4 @@ int lineRenderMode;
 int filter_mode;
 bool opaque_check;
 bool semitrans_check;
+unsigned audio_output_rate = 44100;
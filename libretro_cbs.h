@@ -16,6 +16,7 @@ extern int lineRenderMode;
 extern int filter_mode;
 extern bool opaque_check;
 extern bool semitrans_check;
+extern unsigned audio_output_rate;
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,149 @@
+/* Mednafen - Multi-system Emulator
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "mednafen.h"
+#include "MMapStream.h"
+
+#include <string.h>
+
+#ifdef HAVE_MMAP
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+// Once reads run sequentially, ask the kernel to fetch this far ahead of them.
+#define MMAPSTREAM_READAHEAD (1024 * 1024)
+
+MMapStream *MMapStream::Open(const char *path)
+{
+#ifdef HAVE_MMAP
+   struct stat st;
+   void *mapping;
+   int fd = open(path, O_RDONLY);
+
+   if (fd == -1)
+      return NULL;
+
+   if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size <= 0 || (uint64_t)st.st_size != (size_t)st.st_size)
+   {
+      ::close(fd);
+      return NULL;
+   }
+
+   mapping = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+
+   // The mapping keeps its own reference to the file.
+   ::close(fd);
+
+   if (mapping == MAP_FAILED)
+      return NULL;
+
+   return new MMapStream((uint8 *)mapping, st.st_size);
+#else
+   return NULL;
+#endif
+}
+
+MMapStream::MMapStream(uint8 *data_, uint64_t size_) : data(data_), data_size(size_), position(0), seq_end(~(uint64_t)0), advised_end(0)
+{
+
+}
+
+MMapStream::~MMapStream()
+{
+   close();
+}
+
+uint64_t MMapStream::read(void *dest, uint64_t count, bool error_on_eos)
+{
+   if (position >= data_size)
+      return 0;
+
+   if (count > data_size - position)
+      count = data_size - position;
+
+#ifdef HAVE_MMAP
+   // Continuing where the last read left off: keep the kernel a window ahead,
+   // so a streamed track doesn't fault in page by page.
+   if (position == seq_end && position + count > advised_end)
+   {
+      const uint64_t page  = (uint64_t)sysconf(_SC_PAGESIZE);
+      const uint64_t start = (position + count) & ~(page - 1);
+      uint64_t len         = MMAPSTREAM_READAHEAD;
+
+      if (len > data_size - start)
+         len = data_size - start;
+
+      if (len)
+         madvise(data + start, len, MADV_WILLNEED);
+
+      advised_end = start + len;
+   }
+#endif
+
+   memcpy(dest, data + position, count);
+   position += count;
+   seq_end   = position;
+
+   return count;
+}
+
+void MMapStream::write(const void *src, uint64_t count)
+{
+   // Read-only
+}
+
+void MMapStream::seek(int64_t offset, int whence)
+{
+   switch (whence)
+   {
+      case SEEK_SET:
+         position = offset;
+         break;
+
+      case SEEK_CUR:
+         position += offset;
+         break;
+
+      case SEEK_END:
+         position = data_size + offset;
+         break;
+   }
+}
+
+uint64_t MMapStream::tell(void)
+{
+   return position;
+}
+
+uint64_t MMapStream::size(void)
+{
+   return data_size;
+}
+
+void MMapStream::close(void)
+{
+#ifdef HAVE_MMAP
+   if (data)
+      munmap(data, data_size);
+#endif
+   data      = NULL;
+   data_size = 0;
+   position  = 0;
+}
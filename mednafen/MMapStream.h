@@ -0,0 +1,56 @@
+/* Mednafen - Multi-system Emulator
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef __MDFN_MMAPSTREAM_H
+#define __MDFN_MMAPSTREAM_H
+
+#include "Stream.h"
+
+// Read-only stream over a memory-mapped file, so a read is a memcpy out of the
+// page cache instead of a seek and read through the VFS.
+class MMapStream : public Stream
+{
+   public:
+      // Returns NULL if the file can't be mapped(or mmap isn't available), in
+      // which case the caller should fall back to FileStream.
+      static MMapStream *Open(const char *path);
+
+      virtual ~MMapStream();
+
+      uint8 *map(void) { return data; }
+      void unmap(void) { }
+
+      virtual uint64_t read(void *data, uint64_t count, bool error_on_eos = true);
+      virtual void write(const void *data, uint64_t count);
+      virtual void seek(int64_t offset, int whence);
+      virtual uint64_t tell(void);
+      virtual uint64_t size(void);
+      virtual void close(void);
+
+   private:
+      MMapStream(uint8 *data, uint64_t size);
+
+      uint8 *data;
+      uint64_t data_size;
+      uint64_t position;
+
+      // Sequential-read tracking for read-ahead hints
+      uint64_t seq_end;
+      uint64_t advised_end;
+};
+
+#endif
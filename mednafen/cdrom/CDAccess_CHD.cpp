@@ -24,6 +24,11 @@
 
 extern retro_log_printf_t log_cb;
 
+/* Decompressed hunks kept around(a CD hunk is usually 8 sectors), and
+ * threads decompressing ahead of sequential reads. */
+extern unsigned cd_chd_cache_hunks;
+extern unsigned cd_chd_prefetch_threads;
+
 
 // Disk-image(rip) track/sector formats
 enum
@@ -65,11 +70,21 @@ bool CDAccess_CHD::ImageOpen(const char *path, bool image_memcache)
 
    /* allocate storage for sector reads */
    const chd_header *head = chd_get_header(chd);
-   hunkmem = (uint8_t*)malloc(head->hunkbytes);
+   num_hunks = MAX(cd_chd_cache_hunks, 1);
+   hunks = (CHD_Hunk*)calloc(num_hunks, sizeof(CHD_Hunk));
+   for (unsigned i = 0; i < num_hunks; i++)
+   {
+      hunks[i].hunknum = -1;
+      hunks[i].data    = (uint8_t*)malloc(head->hunkbytes);
+   }
    oldhunk = -1;
    
    log_cb(RETRO_LOG_INFO, "chd_load '%s' hunkbytes=%d\n", path, head->hunkbytes);
 
+#ifdef HAVE_THREADS
+   StartWorkers(path);
+#endif
+
    int plba = -150;
    uint32_t fileOffset = 0;
    //int rlba = 0;
@@ -202,16 +217,37 @@ bool CDAccess_CHD::ImageOpen(const char *path, bool image_memcache)
 
 void CDAccess_CHD::Cleanup(void)
 {
+#ifdef HAVE_THREADS
+   StopWorkers();
+#endif
+
    if(chd != NULL)
       chd_close(chd);
 
-   if (hunkmem != NULL)
-      free(hunkmem);
+   if (hunks != NULL)
+   {
+      for (unsigned i = 0; i < num_hunks; i++)
+         free(hunks[i].data);
+      free(hunks);
+   }
 }
 
 CDAccess_CHD::CDAccess_CHD(const char *path, bool image_memcache)
 {
    chd = NULL;
+   hunks = NULL;
+   num_hunks = 0;
+   hunk_clock = 0;
+   cur_hunk = NULL;
+#ifdef HAVE_THREADS
+   workers = NULL;
+   num_workers = 0;
+   prefetch_depth = 0;
+   workers_quit = false;
+   hunk_lock = NULL;
+   work_cond = NULL;
+   done_cond = NULL;
+#endif
 
    NumTracks = 0;
    total_sectors = 0;
@@ -231,116 +267,260 @@ CDAccess_CHD::~CDAccess_CHD()
    Cleanup();
 }
 
-// Note: this function makes use of the current contents(as in |=) in SubPWBuf.
-int32_t CDAccess_CHD::MakeSubPQ(int32 lba, uint8 *SubPWBuf)
+CDAccess_CHD::CHD_Hunk *CDAccess_CHD::FindHunk(int32_t hunknum)
 {
-   unsigned i;
-   uint8_t buf[0xC], adr, control;
-   int32_t track;
-   uint32_t lba_relative;
-   uint32_t ma, sa, fa;
-   uint32_t m, s, f;
-   uint8_t pause_or = 0x00;
-   bool track_found = false;
+   for (unsigned i = 0; i < num_hunks; i++)
+   {
+      if (hunks[i].hunknum == hunknum && hunks[i].state != HUNK_EMPTY)
+         return &hunks[i];
+   }
+
+   return NULL;
+}
 
-   for(track = FirstTrack; track < (FirstTrack + NumTracks); track++)
+/* Picks the least recently used hunk a worker isn't decompressing into.
+ * Queued prefetches can be taken back. */
+CDAccess_CHD::CHD_Hunk *CDAccess_CHD::EvictHunk(void)
+{
+   CHD_Hunk *victim = NULL;
+
+   for (unsigned i = 0; i < num_hunks; i++)
    {
-      if(lba >= (Tracks[track].LBA - Tracks[track].pregap_dv - Tracks[track].pregap) && lba < (Tracks[track].LBA + Tracks[track].sectors + Tracks[track].postgap))
-      {
-         track_found = true;
-         break;
-      }
+      if (hunks[i].state == HUNK_EMPTY)
+         return &hunks[i];
+
+      if (hunks[i].state != HUNK_BUSY && (!victim || (int32_t)(hunks[i].last_used - victim->last_used) < 0))
+         victim = &hunks[i];
+   }
+
+   victim->hunknum = -1;
+   victim->state   = HUNK_EMPTY;
+
+   return victim;
+}
+
+/* Returns the decompressed hunk, or NULL if it can't be read. */
+const uint8_t *CDAccess_CHD::ReadHunk(int32_t hunknum)
+{
+   CHD_Hunk *hunk;
+   bool sequential = (hunknum == oldhunk + 1);
+
+   /* Only this thread assigns hunks to slots, so the last one can't have
+    * been taken away. */
+   if (hunknum == oldhunk && cur_hunk && cur_hunk->hunknum == hunknum)
+      return cur_hunk->data;
+
+#ifdef HAVE_THREADS
+   if (num_workers)
+      slock_lock(hunk_lock);
+
+   /* Wait out a worker that is already decompressing it */
+   while ((hunk = FindHunk(hunknum)) && hunk->state == HUNK_BUSY)
+      scond_wait(done_cond, hunk_lock);
+#else
+   hunk = FindHunk(hunknum);
+#endif
+
+   if (!hunk)
+   {
+      hunk = EvictHunk();
+      hunk->hunknum = hunknum;
    }
 
-   //printf("%d %d\n", Tracks[1].LBA, Tracks[1].sectors);
+   hunk->last_used = ++hunk_clock;
 
-   if(!track_found)
+   /* Not decompressed yet, or still queued: don't wait for a worker */
+   if (hunk->state != HUNK_READY)
    {
-      printf("MakeSubPQ error for sector %u!", lba);
-      track = FirstTrack;
+      int err;
+
+      hunk->state = HUNK_BUSY;
+#ifdef HAVE_THREADS
+      if (num_workers)
+         slock_unlock(hunk_lock);
+#endif
+
+      err = chd_read(chd, hunknum, hunk->data);
+
+#ifdef HAVE_THREADS
+      if (num_workers)
+         slock_lock(hunk_lock);
+#endif
+
+      if (err != CHDERR_NONE)
+      {
+         log_cb(RETRO_LOG_ERROR, "chd_read_sector failed hunk=%d error=%d\n", hunknum, err);
+         hunk->hunknum = -1;
+         hunk->state   = HUNK_EMPTY;
+         hunk          = NULL;
+      }
+      else
+         hunk->state = HUNK_READY;
    }
 
-   lba_relative = abs((int32)lba - Tracks[track].LBA);
+#ifdef HAVE_THREADS
+   if (hunk && sequential && num_workers)
+      QueuePrefetch(hunknum);
+
+   if (num_workers)
+      slock_unlock(hunk_lock);
+#endif
 
-   f            = (lba_relative % 75);
-   s            = ((lba_relative / 75) % 60);
-   m            = (lba_relative / 75 / 60);
+   oldhunk  = hunk ? hunknum : -1;
+   cur_hunk = hunk;
 
-   fa           = (lba + 150) % 75;
-   sa           = ((lba + 150) / 75) % 60;
-   ma           = ((lba + 150) / 75 / 60);
+   return hunk ? hunk->data : NULL;
+}
 
-   adr          = 0x1; // Q channel data encodes position
-   control      = Tracks[track].subq_control;
+#ifdef HAVE_THREADS
+/* Called with hunk_lock held. */
+void CDAccess_CHD::QueuePrefetch(int32_t hunknum)
+{
+   const chd_header *head = chd_get_header(chd);
+   bool queued = false;
 
-   // Handle pause(D7 of interleaved subchannel byte) bit, should be set to 1 when in pregap or postgap.
-   if((lba < Tracks[track].LBA) || (lba >= Tracks[track].LBA + Tracks[track].sectors))
+   for (unsigned i = 1; i <= prefetch_depth; i++)
    {
-      //printf("pause_or = 0x80 --- %d\n", lba);
-      pause_or = 0x80;
+      CHD_Hunk *hunk;
+
+      if (hunknum + i >= head->totalhunks)
+         break;
+
+      if (FindHunk(hunknum + i))
+         continue;
+
+      hunk            = EvictHunk();
+      hunk->hunknum   = hunknum + i;
+      hunk->state     = HUNK_QUEUED;
+      hunk->last_used = ++hunk_clock;
+      queued          = true;
    }
 
-   // Handle pregap between audio->data track
+   if (queued)
+      scond_broadcast(work_cond);
+}
+
+void CDAccess_CHD::WorkerStart(void *arg)
+{
+   CHD_Worker *worker = (CHD_Worker*)arg;
+
+   worker->owner->WorkerRun(worker->chd);
+}
+
+void CDAccess_CHD::WorkerRun(chd_file *worker_chd)
+{
+   slock_lock(hunk_lock);
+
+   while (!workers_quit)
    {
-      int32_t pg_offset = (int32)lba - Tracks[track].LBA;
-
-      // If we're more than 2 seconds(150 sectors) from the real "start" of the track/INDEX 01, and the track is a data track,
-      // and the preceding track is an audio track, encode it as audio(by taking the SubQ control field from the preceding track).
-      //
-      // TODO: Look into how we're supposed to handle subq control field in the four combinations of track types(data/audio).
-      //
-      if(pg_offset < -150)
+      CHD_Hunk *next = NULL;
+      int32_t hunknum;
+      int err;
+
+      /* Oldest queued first, which is the nearest one */
+      for (unsigned i = 0; i < num_hunks; i++)
       {
-         if((Tracks[track].subq_control & SUBQ_CTRLF_DATA) && (FirstTrack < track) && !(Tracks[track - 1].subq_control & SUBQ_CTRLF_DATA))
-         {
-            //printf("Pregap part 1 audio->data: lba=%d track_lba=%d\n", lba, Tracks[track].LBA);
-            control = Tracks[track - 1].subq_control;
-         }
+         if (hunks[i].state == HUNK_QUEUED && (!next || (int32_t)(hunks[i].last_used - next->last_used) < 0))
+            next = &hunks[i];
+      }
+
+      if (!next)
+      {
+         scond_wait(work_cond, hunk_lock);
+         continue;
+      }
+
+      next->state = HUNK_BUSY;
+      hunknum     = next->hunknum;
+      slock_unlock(hunk_lock);
+
+      err = chd_read(worker_chd, hunknum, next->data);
+
+      slock_lock(hunk_lock);
+      if (err != CHDERR_NONE)
+      {
+         next->hunknum = -1;
+         next->state   = HUNK_EMPTY;
       }
+      else
+         next->state = HUNK_READY;
+
+      scond_signal(done_cond);
    }
 
-   memset(buf, 0, 0xC);
-   buf[0] = (adr << 0) | (control << 4);
-   buf[1] = U8_to_BCD(track);
+   slock_unlock(hunk_lock);
+}
 
-   if(lba < Tracks[track].LBA) // Index is 00 in pregap
-      buf[2] = U8_to_BCD(0x00);
-   else
-      buf[2] = U8_to_BCD(0x01);
+void CDAccess_CHD::StartWorkers(const char *path)
+{
+   unsigned count = cd_chd_prefetch_threads;
 
-   /* Track relative MSF address */
-   buf[3] = U8_to_BCD(m);
-   buf[4] = U8_to_BCD(s);
-   buf[5] = U8_to_BCD(f);
-   buf[6] = 0;
-   /* Absolute MSF address */
-   buf[7] = U8_to_BCD(ma);
-   buf[8] = U8_to_BCD(sa);
-   buf[9] = U8_to_BCD(fa);
+   /* Every worker can hold a hunk, and the reader needs one more plus some
+    * to prefetch into. */
+   if (num_hunks < 4)
+      count = 0;
+   count = MIN(count, (num_hunks - 2) / 2);
 
-   subq_generate_checksum(buf);
+   if (!count)
+      return;
 
-   if(!SubQReplaceMap.empty())
+   hunk_lock = slock_new();
+   work_cond = scond_new();
+   done_cond = scond_new();
+   workers   = (CHD_Worker*)calloc(count, sizeof(CHD_Worker));
+
+   for (num_workers = 0; num_workers < count; num_workers++)
    {
-      //printf("%d\n", lba);
-      std::map<uint32, cpp11_array_doodad>::const_iterator it = SubQReplaceMap.find(LBA_to_ABA(lba));
+      CHD_Worker *worker = &workers[num_workers];
+
+      if (chd_open(path, CHD_OPEN_READ, NULL, &worker->chd) != CHDERR_NONE)
+         break;
 
-      if(it != SubQReplaceMap.end())
+      worker->owner  = this;
+      worker->thread = sthread_create(WorkerStart, worker);
+      if (!worker->thread)
       {
-         //printf("Replace: %d\n", lba);
-         memcpy(buf, it->second.data, 12);
+         chd_close(worker->chd);
+         break;
       }
    }
 
-   for (i = 0; i < 96; i++)
-      SubPWBuf[i] |= (((buf[i >> 3] >> (7 - (i & 0x7))) & 1) ? 0x40 : 0x00) | pause_or;
+   prefetch_depth = MIN(num_workers * 4, num_hunks / 2);
 
-   return track;
+   log_cb(RETRO_LOG_INFO, "[CHD] Caching %u hunks, %u prefetch threads.\n", num_hunks, num_workers);
 }
 
+void CDAccess_CHD::StopWorkers(void)
+{
+   if (!workers)
+      return;
+
+   slock_lock(hunk_lock);
+   workers_quit = true;
+   scond_broadcast(work_cond);
+   slock_unlock(hunk_lock);
+
+   for (unsigned i = 0; i < num_workers; i++)
+   {
+      sthread_join(workers[i].thread);
+      chd_close(workers[i].chd);
+   }
+
+   free(workers);
+   workers     = NULL;
+   num_workers = 0;
+
+   slock_free(hunk_lock);
+   scond_free(work_cond);
+   scond_free(done_cond);
+   hunk_lock = NULL;
+   work_cond = NULL;
+   done_cond = NULL;
+}
+#endif
+
 bool CDAccess_CHD::Read_Raw_Sector(uint8 *buf, int32 lba)
 {
-   uint8_t SimuQ[0xC];
    int32_t track;
    CDRFILE_TRACK_INFO *ct;
 
@@ -372,8 +552,9 @@ bool CDAccess_CHD::Read_Raw_Sector(uint8 *buf, int32 lba)
    }
 
    memset(buf + 2352, 0, 96);
-   track = MakeSubPQ(lba, buf + 2352);
-   subq_deinterleave(buf + 2352, SimuQ);
+   track = SubQ.MakeSubPQ(lba, buf + 2352);
+   if (track < 0)
+      track = FirstTrack;
 
    ct = &Tracks[track];
 
@@ -423,19 +604,12 @@ bool CDAccess_CHD::Read_Raw_Sector(uint8 *buf, int32 lba)
       int sph = head->hunkbytes / (2352 + 96);
       int hunknum = cad / sph; //(cad * head->unitbytes) / head->hunkbytes;
       int hunkofs = cad % sph; //(cad * head->unitbytes) % head->hunkbytes;
-      int err = CHDERR_NONE;
+      const uint8_t *hunkmem = ReadHunk(hunknum);
 
-      /* each hunk holds ~8 sectors, optimize when reading contiguous sectors */
-      if (hunknum != oldhunk)
-      {
-         err = chd_read(chd, hunknum, hunkmem);
-         if (err != CHDERR_NONE)
-            log_cb(RETRO_LOG_ERROR, "chd_read_sector failed lba=%d error=%d\n", lba, err);
-         else
-            oldhunk = hunknum;
-      }
-
-      memcpy(buf, hunkmem + hunkofs * (2352 + 96), 2352);
+      if (hunkmem)
+         memcpy(buf, hunkmem + hunkofs * (2352 + 96), 2352);
+      else
+         memset(buf, 0, 2352);
 
       if (ct->DIFormat == DI_FORMAT_AUDIO && ct->RawAudioMSBFirst)
          Endian_A16_Swap(buf, 588 * 2);
@@ -446,7 +620,7 @@ bool CDAccess_CHD::Read_Raw_Sector(uint8 *buf, int32 lba)
 bool CDAccess_CHD::Read_Raw_PW(uint8_t *buf, int32_t lba)
 {
    memset(buf, 0, 96);
-   MakeSubPQ(lba, buf);
+   SubQ.MakeSubPQ(lba, buf);
    return true;
 }
 
@@ -474,8 +648,7 @@ bool CDAccess_CHD::Read_TOC(TOC *toc)
    if (toc->last_track < 99)
       toc->tracks[toc->last_track + 1] = toc->tracks[100];
 
-   if (!SubQReplaceMap.empty())
-      SubQReplaceMap.clear();
+   SubQ.Build(Tracks, FirstTrack, NumTracks, total_sectors);
 
    // Load SBI file, if present
    if (filestream_exists(sbi_path.c_str()))
@@ -517,11 +690,11 @@ int CDAccess_CHD::LoadSBI(const char* sbi_path)
 
       uint32 aba = AMSF_to_ABA(BCD_to_U8(ed[0]), BCD_to_U8(ed[1]), BCD_to_U8(ed[2]));
 
-      memcpy(SubQReplaceMap[aba].data, tmpq, 12);
+      SubQ.Replace(aba, tmpq);
    }
 
 #if 0
-   MDFN_printf(_("Loaded Q subchannel replacements for %zu sectors.\n"), SubQReplaceMap.size());
+   MDFN_printf(_("Loaded Q subchannel replacements for %u sectors.\n"), SubQ.ReplaceCount());
 #endif
    log_cb(RETRO_LOG_INFO, "[CHD] Loaded SBI file %s\n", sbi_path);
    return 0;
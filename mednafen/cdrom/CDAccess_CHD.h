@@ -6,6 +6,10 @@
 
 #include "chd.h"
 
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#endif
+
 class CDAccess_CHD : public CDAccess
 {
    public:
@@ -23,11 +27,59 @@ class CDAccess_CHD : public CDAccess
 
    private:
       chd_file *chd;
-      /* hunk data cache */
-      uint8_t *hunkmem;
-      /* last hunknum read */
+
+      /* LRU cache of decompressed hunks */
+      enum
+      {
+         HUNK_EMPTY = 0,
+         HUNK_QUEUED,   /* waiting for a prefetch worker */
+         HUNK_BUSY,     /* being decompressed */
+         HUNK_READY
+      };
+
+      struct CHD_Hunk
+      {
+         int32_t hunknum;
+         uint32_t last_used;
+         int state;
+         uint8_t *data;
+      };
+
+      CHD_Hunk *hunks;
+      CHD_Hunk *cur_hunk;
+      unsigned num_hunks;
+      uint32_t hunk_clock;
+      /* last hunknum read, to detect sequential access */
       int oldhunk;
 
+      const uint8_t *ReadHunk(int32_t hunknum);
+      CHD_Hunk *FindHunk(int32_t hunknum);
+      CHD_Hunk *EvictHunk(void);
+
+#ifdef HAVE_THREADS
+      /* Prefetch workers, each with its own chd_file since chd_read() isn't reentrant */
+      struct CHD_Worker
+      {
+         CDAccess_CHD *owner;
+         chd_file *chd;
+         sthread_t *thread;
+      };
+
+      CHD_Worker *workers;
+      unsigned num_workers;
+      unsigned prefetch_depth;
+      bool workers_quit;
+      slock_t *hunk_lock;
+      scond_t *work_cond;   /* signalled when a hunk is queued */
+      scond_t *done_cond;   /* signalled when a hunk is decompressed */
+
+      static void WorkerStart(void *arg);
+      void WorkerRun(chd_file *worker_chd);
+      void StartWorkers(const char *path);
+      void StopWorkers(void);
+      void QueuePrefetch(int32_t hunknum);
+#endif
+
       int32_t NumTracks;
       int32_t FirstTrack;
       int32_t LastTrack;
@@ -41,12 +93,7 @@ class CDAccess_CHD : public CDAccess
       void Cleanup(void);
 
       CDRFILE_TRACK_INFO Tracks[100]; // Track #0(HMM?) through 99
-      struct cpp11_array_doodad
-      {
-         uint8 data[12];
-      };
-      std::map<uint32, cpp11_array_doodad> SubQReplaceMap;
-      int32_t MakeSubPQ(int32 lba, uint8 *SubPWBuf);
+      SubQTable SubQ;
 };
 
 
@@ -45,6 +45,7 @@
 #include "../general.h"
 #include "../FileStream.h"
 #include "../MemoryStream.h"
+#include "../MMapStream.h"
 
 #include "CDAccess.h"
 #include "CDAccess_Image.h"
@@ -216,6 +217,30 @@ uint32 CDAccess_Image::GetSectorCount(CDRFILE_TRACK_INFO *track)
    return((size - track->FileOffset) / DI_Size_Table[track->DIFormat]);
 }
 
+// Uncompressed track data is read straight out of a file mapping where possible,
+// which saves a seek and a VFS read per sector; FileStream is the fallback for
+// anything that can't be mapped. Returns NULL if the file couldn't be opened.
+static Stream *OpenTrackStream(const char *path, bool image_memcache)
+{
+   Stream *fp;
+
+   if(!image_memcache && (fp = MMapStream::Open(path)))
+      return fp;
+
+   fp = new FileStream(path, MODE_READ);
+
+   if(fp->tell() == UINT64_C(-1))
+   {
+      delete fp;
+      return NULL;
+   }
+
+   if(image_memcache)
+      fp = new MemoryStream(fp);
+
+   return fp;
+}
+
 bool CDAccess_Image::ParseTOCFileLineInfo(CDRFILE_TRACK_INFO *track, const int tracknum,
       const std::string &filename, const char *binoffset, const char *msfoffset,
       const char *length, bool image_memcache, std::map<std::string, Stream*> &toc_streamcache)
@@ -243,10 +268,10 @@ bool CDAccess_Image::ParseTOCFileLineInfo(CDRFILE_TRACK_INFO *track, const int t
 
       efn = MDFN_EvalFIP(base_dir, filename);
 
-      if(image_memcache)
-         track->fp = new MemoryStream(new FileStream(efn.c_str(), MODE_READ));
-      else
-         track->fp = new FileStream(efn.c_str(), MODE_READ);
+      track->fp = OpenTrackStream(efn.c_str(), image_memcache);
+
+      if(!track->fp)
+         return false;
 
       toc_streamcache[filename] = track->fp;
    }
@@ -351,10 +376,10 @@ int CDAccess_Image::LoadSBI(const char* sbi_path)
 
       uint32 aba = AMSF_to_ABA(BCD_to_U8(ed[0]), BCD_to_U8(ed[1]), BCD_to_U8(ed[2]));
 
-      memcpy(SubQReplaceMap[aba].data, tmpq, 12);
+      SubQ.Replace(aba, tmpq);
    }
 
-   //MDFN_printf(_("Loaded Q subchannel replacements for %zu sectors.\n"), SubQReplaceMap.size());
+   //MDFN_printf(_("Loaded Q subchannel replacements for %u sectors.\n"), SubQ.ReplaceCount());
    log_cb(RETRO_LOG_INFO, "[Image] Loaded SBI file %s\n", sbi_path);
    filestream_close(sbis);
    return 0;
@@ -527,7 +552,8 @@ bool CDAccess_Image::ImageOpen(const char *path, bool image_memcache)
                length = args[2].c_str();
             }
             //printf("%s, %s, %s, %s\n", args[0].c_str(), binoffset, msfoffset, length);
-            ParseTOCFileLineInfo(&TmpTrack, active_track, args[0], binoffset, msfoffset, length, image_memcache, toc_streamcache);
+            if(!ParseTOCFileLineInfo(&TmpTrack, active_track, args[0], binoffset, msfoffset, length, image_memcache, toc_streamcache))
+               return false;
          }
          else if(cmdbuf == "DATAFILE")
          {
@@ -542,7 +568,8 @@ bool CDAccess_Image::ImageOpen(const char *path, bool image_memcache)
             else
                length = args[1].c_str();
 
-            ParseTOCFileLineInfo(&TmpTrack, active_track, args[0], binoffset, NULL, length, image_memcache, toc_streamcache);
+            if(!ParseTOCFileLineInfo(&TmpTrack, active_track, args[0], binoffset, NULL, length, image_memcache, toc_streamcache))
+               return false;
          }
          else if(cmdbuf == "INDEX")
          {
@@ -636,14 +663,12 @@ bool CDAccess_Image::ImageOpen(const char *path, bool image_memcache)
             }
 
             std::string efn = MDFN_EvalFIP(base_dir, args[0]);
-            TmpTrack.fp = new FileStream(efn.c_str(), MODE_READ);
-            TmpTrack.FirstFileInstance = 1;
+            TmpTrack.fp = OpenTrackStream(efn.c_str(), image_memcache);
 
-            if (TmpTrack.fp->tell() == UINT64_C(-1))
+            if (!TmpTrack.fp)
                return false;
 
-            if(image_memcache)
-               TmpTrack.fp = new MemoryStream(TmpTrack.fp);
+            TmpTrack.FirstFileInstance = 1;
 
             if(!strcasecmp(args[1].c_str(), "BINARY"))
             {
@@ -899,6 +924,8 @@ bool CDAccess_Image::ImageOpen(const char *path, bool image_memcache)
 
    total_sectors = RunningLBA;
 
+   SubQ.Build(Tracks, FirstTrack, NumTracks, total_sectors);
+
    //
    // Load SBI file, if present
    //
@@ -968,114 +995,103 @@ CDAccess_Image::~CDAccess_Image()
 bool CDAccess_Image::Read_Raw_Sector(uint8 *buf, int32 lba)
 {
    int32_t track;
-   uint8_t SimuQ[0xC];
-   bool TrackFound = false;
+   CDRFILE_TRACK_INFO *ct;
 
    memset(buf + 2352, 0, 96);
 
-   MakeSubPQ(lba, buf + 2352);
-
-   subq_deinterleave(buf + 2352, SimuQ);
+   track = SubQ.MakeSubPQ(lba, buf + 2352);
 
-   for(track = FirstTrack; track < (FirstTrack + NumTracks); track++)
+   if(track < 0)
    {
-      CDRFILE_TRACK_INFO *ct = &Tracks[track];
+      MDFN_Error(0, _("Could not find track for sector %u!"), lba);
+      return false;
+   }
+
+   ct = &Tracks[track];
 
-      if(lba >= (ct->LBA - ct->pregap_dv - ct->pregap) && lba < (ct->LBA + ct->sectors + ct->postgap))
+   // Handle pregap and postgap reading
+   if(lba < (ct->LBA - ct->pregap_dv) || lba >= (ct->LBA + ct->sectors))
+   {
+      //printf("Pre/post-gap read, LBA=%d(LBA-track_start_LBA=%d)\n", lba, lba - ct->LBA);
+      memset(buf, 0, 2352);	// Null sector data, per spec
+   }
+   else
+   {
+      if(ct->AReader)
       {
-         TrackFound = true;
+         int16 AudioBuf[588 * 2];
+         int frames_read = ct->AReader->Read((ct->FileOffset / 4) + (lba - ct->LBA) * 588, AudioBuf, 588);
+
+         ct->LastSamplePos += frames_read;
 
-         // Handle pregap and postgap reading
-         if(lba < (ct->LBA - ct->pregap_dv) || lba >= (ct->LBA + ct->sectors))
+         if(frames_read < 0 || frames_read > 588)	// This shouldn't happen.
          {
-            //printf("Pre/post-gap read, LBA=%d(LBA-track_start_LBA=%d)\n", lba, lba - ct->LBA);
-            memset(buf, 0, 2352);	// Null sector data, per spec
+            printf("Error: frames_read out of range: %d\n", frames_read);
+            frames_read = 0;
          }
-         else
-         {
-            if(ct->AReader)
-            {
-               int16 AudioBuf[588 * 2];
-               int frames_read = ct->AReader->Read((ct->FileOffset / 4) + (lba - ct->LBA) * 588, AudioBuf, 588);
 
-               ct->LastSamplePos += frames_read;
+         if(frames_read < 588)
+            memset((uint8 *)AudioBuf + frames_read * 2 * sizeof(int16), 0, (588 - frames_read) * 2 * sizeof(int16));
 
-               if(frames_read < 0 || frames_read > 588)	// This shouldn't happen.
-               {
-                  printf("Error: frames_read out of range: %d\n", frames_read);
-                  frames_read = 0;
-               }
-
-               if(frames_read < 588)
-                  memset((uint8 *)AudioBuf + frames_read * 2 * sizeof(int16), 0, (588 - frames_read) * 2 * sizeof(int16));
-
-               for(int i = 0; i < 588 * 2; i++)
-                  MDFN_en16lsb(buf + i * 2, AudioBuf[i]);
-            }
-            else	// Binary, woo.
-            {
-               long SeekPos = ct->FileOffset;
-               long LBARelPos = lba - ct->LBA;
-
-               SeekPos += LBARelPos * DI_Size_Table[ct->DIFormat];
+         for(int i = 0; i < 588 * 2; i++)
+            MDFN_en16lsb(buf + i * 2, AudioBuf[i]);
+      }
+      else	// Binary, woo.
+      {
+         long SeekPos = ct->FileOffset;
+         long LBARelPos = lba - ct->LBA;
 
-               if(ct->SubchannelMode)
-                  SeekPos += 96 * (lba - ct->LBA);
+         SeekPos += LBARelPos * DI_Size_Table[ct->DIFormat];
 
-               ct->fp->seek(SeekPos, SEEK_SET);
+         if(ct->SubchannelMode)
+            SeekPos += 96 * (lba - ct->LBA);
 
-               switch(ct->DIFormat)
-               {
-                  case DI_FORMAT_AUDIO:
-                     ct->fp->read(buf, 2352);
+         ct->fp->seek(SeekPos, SEEK_SET);
 
-                     if(ct->RawAudioMSBFirst)
-                        Endian_A16_Swap(buf, 588 * 2);
-                     break;
+         switch(ct->DIFormat)
+         {
+            case DI_FORMAT_AUDIO:
+               ct->fp->read(buf, 2352);
 
-                  case DI_FORMAT_MODE1:
-                     ct->fp->read(buf + 12 + 3 + 1, 2048);
-                     encode_mode1_sector(lba + 150, buf);
-                     break;
+               if(ct->RawAudioMSBFirst)
+                  Endian_A16_Swap(buf, 588 * 2);
+               break;
 
-                  case DI_FORMAT_MODE1_RAW:
-                  case DI_FORMAT_MODE2_RAW:
-                     ct->fp->read(buf, 2352);
-                     break;
+            case DI_FORMAT_MODE1:
+               ct->fp->read(buf + 12 + 3 + 1, 2048);
+               // The CDC only needs the EDC; it fills in the P/Q parity itself in the read modes that expose it.
+               encode_mode1_sector_no_ecc(lba + 150, buf);
+               break;
 
-                  case DI_FORMAT_MODE2:
-                     ct->fp->read(buf + 16, 2336);
-                     encode_mode2_sector(lba + 150, buf);
-                     break;
+            case DI_FORMAT_MODE1_RAW:
+            case DI_FORMAT_MODE2_RAW:
+               ct->fp->read(buf, 2352);
+               break;
 
+            case DI_FORMAT_MODE2:
+               ct->fp->read(buf + 16, 2336);
+               encode_mode2_sector(lba + 150, buf);
+               break;
 
-                     // FIXME: M2F1, M2F2, does sub-header come before or after user data(standards say before, but I wonder
-                     // about cdrdao...).
-                  case DI_FORMAT_MODE2_FORM1:
-                     ct->fp->read(buf + 24, 2048);
-                     //encode_mode2_form1_sector(lba + 150, buf);
-                     break;
 
-                  case DI_FORMAT_MODE2_FORM2:
-                     ct->fp->read(buf + 24, 2324);
-                     //encode_mode2_form2_sector(lba + 150, buf);
-                     break;
+               // FIXME: M2F1, M2F2, does sub-header come before or after user data(standards say before, but I wonder
+               // about cdrdao...).
+            case DI_FORMAT_MODE2_FORM1:
+               ct->fp->read(buf + 24, 2048);
+               //encode_mode2_form1_sector(lba + 150, buf);
+               break;
 
-               }
+            case DI_FORMAT_MODE2_FORM2:
+               ct->fp->read(buf + 24, 2324);
+               //encode_mode2_form2_sector(lba + 150, buf);
+               break;
 
-               if(ct->SubchannelMode)
-                  ct->fp->read(buf + 2352, 96);
-            }
-         } // end if audible part of audio track read.
-         break;
-      } // End if LBA is in range
-   } // end track search loop
+         }
 
-   if(!TrackFound)
-   {
-      MDFN_Error(0, _("Could not find track for sector %u!"), lba);
-      return false;
-   }
+         if(ct->SubchannelMode)
+            ct->fp->read(buf + 2352, 96);
+      }
+   } // end if audible part of audio track read.
 
 #if 0
    if(qbuf[0] & 0x40)
@@ -1086,7 +1102,7 @@ bool CDAccess_Image::Read_Raw_Sector(uint8 *buf, int32 lba)
       memcpy(dummy_buf + 16, buf + 16, 2048); 
       memset(dummy_buf + 2352, 0, 96);
 
-      MakeSubPQ(lba, dummy_buf + 2352);
+      SubQ.MakeSubPQ(lba, dummy_buf + 2352);
       encode_mode1_sector(lba + 150, dummy_buf);
 
       for(int i = 0; i < 2352 + 96; i++)
@@ -1108,116 +1124,10 @@ bool CDAccess_Image::Read_Raw_Sector(uint8 *buf, int32 lba)
    return true;
 }
 
-// Note: this function makes use of the current contents(as in |=) in SubPWBuf.
-void CDAccess_Image::MakeSubPQ(int32 lba, uint8 *SubPWBuf)
-{
-   unsigned i;
-   uint8_t buf[0xC], adr, control;
-   int32_t track;
-   uint32_t lba_relative;
-   uint32_t ma, sa, fa;
-   uint32_t m, s, f;
-   uint8_t pause_or = 0x00;
-   bool track_found = false;
-
-   for(track = FirstTrack; track < (FirstTrack + NumTracks); track++)
-   {
-      if(lba >= (Tracks[track].LBA - Tracks[track].pregap_dv - Tracks[track].pregap) 
-            && lba < (Tracks[track].LBA + Tracks[track].sectors + Tracks[track].postgap))
-      {
-         track_found = true;
-         break;
-      }
-   }
-
-   //printf("%d %d\n", Tracks[1].LBA, Tracks[1].sectors);
-
-   if(!track_found)
-   {
-      printf("MakeSubPQ error for sector %u!", lba);
-      track = FirstTrack;
-   }
-
-   lba_relative = abs((int32)lba - Tracks[track].LBA);
-
-   f            = (lba_relative % 75);
-   s            = ((lba_relative / 75) % 60);
-   m            = (lba_relative / 75 / 60);
-
-   fa           = (lba + 150) % 75;
-   sa           = ((lba + 150) / 75) % 60;
-   ma           = ((lba + 150) / 75 / 60);
-
-   adr          = 0x1; // Q channel data encodes position
-   control      = Tracks[track].subq_control;
-
-   // Handle pause(D7 of interleaved subchannel byte) bit, should be set to 1 when in pregap or postgap.
-   if((lba < Tracks[track].LBA) || (lba >= Tracks[track].LBA + Tracks[track].sectors))
-   {
-      //printf("pause_or = 0x80 --- %d\n", lba);
-      pause_or = 0x80;
-   }
-
-   // Handle pregap between audio->data track
-   {
-      int32_t pg_offset = (int32)lba - Tracks[track].LBA;
-
-      // If we're more than 2 seconds(150 sectors) from the real "start" of the track/INDEX 01, and the track is a data track,
-      // and the preceding track is an audio track, encode it as audio(by taking the SubQ control field from the preceding track).
-      //
-      // TODO: Look into how we're supposed to handle subq control field in the four combinations of track types(data/audio).
-      //
-      if(pg_offset < -150)
-      {
-         if((Tracks[track].subq_control & SUBQ_CTRLF_DATA) && (FirstTrack < track) && !(Tracks[track - 1].subq_control & SUBQ_CTRLF_DATA))
-         {
-            //printf("Pregap part 1 audio->data: lba=%d track_lba=%d\n", lba, Tracks[track].LBA);
-            control = Tracks[track - 1].subq_control;
-         }
-      }
-   }
-
-   memset(buf, 0, 0xC);
-   buf[0] = (adr << 0) | (control << 4);
-   buf[1] = U8_to_BCD(track);
-
-   if(lba < Tracks[track].LBA) // Index is 00 in pregap
-      buf[2] = U8_to_BCD(0x00);
-   else
-      buf[2] = U8_to_BCD(0x01);
-
-   /* Track relative MSF address */
-   buf[3] = U8_to_BCD(m);
-   buf[4] = U8_to_BCD(s);
-   buf[5] = U8_to_BCD(f);
-   buf[6] = 0;
-   /* Absolute MSF address */
-   buf[7] = U8_to_BCD(ma);
-   buf[8] = U8_to_BCD(sa);
-   buf[9] = U8_to_BCD(fa);
-
-   subq_generate_checksum(buf);
-
-   if(!SubQReplaceMap.empty())
-   {
-      //printf("%d\n", lba);
-      std::map<uint32, cpp11_array_doodad>::const_iterator it = SubQReplaceMap.find(LBA_to_ABA(lba));
-
-      if(it != SubQReplaceMap.end())
-      {
-         //printf("Replace: %d\n", lba);
-         memcpy(buf, it->second.data, 12);
-      }
-   }
-
-   for (i = 0; i < 96; i++)
-      SubPWBuf[i] |= (((buf[i >> 3] >> (7 - (i & 0x7))) & 1) ? 0x40 : 0x00) | pause_or;
-}
-
 bool CDAccess_Image::Read_Raw_PW(uint8_t *buf, int32_t lba)
 {
    memset(buf, 0, 96);
-   MakeSubPQ(lba, buf);
+   SubQ.MakeSubPQ(lba, buf);
    return true;
 }
 
@@ -3,6 +3,8 @@
 
 #include <map>
 
+#include "SubQTable.h"
+
 class Stream;
 class AudioReader;
 
@@ -55,12 +57,7 @@ class CDAccess_Image : public CDAccess
       uint8_t disc_type;
       CDRFILE_TRACK_INFO Tracks[100]; // Track #0(HMM?) through 99
 
-      struct cpp11_array_doodad
-      {
-         uint8 data[12];
-      };
-
-      std::map<uint32, cpp11_array_doodad> SubQReplaceMap;
+      SubQTable SubQ;
 
       std::string base_dir;
 
@@ -68,9 +65,6 @@ class CDAccess_Image : public CDAccess
       int LoadSBI(const char* sbi_path);
       void Cleanup(void);
 
-      // MakeSubPQ will OR the simulated P and Q subchannel data into SubPWBuf.
-      void MakeSubPQ(int32_t lba, uint8_t *SubPWBuf);
-
       bool ParseTOCFileLineInfo(CDRFILE_TRACK_INFO *track, const int tracknum,
             const std::string &filename, const char *binoffset, const char *msfoffset,
             const char *length, bool image_memcache, std::map<std::string, Stream*> &toc_streamcache);
@@ -50,6 +50,11 @@ extern retro_log_printf_t log_cb;
 
 // very hacky but currently the only way to update the disc start offset class variable from libretro.cpp
 extern int CD_SelectedDisc;
+
+// Decompressed blocks kept around, and threads decompressing ahead of
+// sequential reads.
+extern unsigned cd_pbp_cache_blocks;
+extern unsigned cd_pbp_prefetch_threads;
 int PBP_DiscCount;
 
 // Disk-image(rip) track/sector formats
@@ -217,17 +222,50 @@ void CDAccess_PBP::Cleanup(void)
    }
    if(index_table != NULL)
       free(index_table);
+
+#ifdef HAVE_THREADS
+   StopWorkers();
+#endif
+
+   if(blocks != NULL)
+      free(blocks);
+   if(inflater != NULL)
+   {
+      if(inflater->zalloc)
+         inflateEnd(inflater);
+      free(inflater);
+   }
 }
 
 CDAccess_PBP::CDAccess_PBP(const char *path, bool image_memcache) : NumTracks(0), FirstTrack(0), LastTrack(0), total_sectors(0)
 {
    is_official = false;
    index_table = NULL;
+   index_count = 0;
    fp = NULL;
+   num_blocks = MAX(cd_pbp_cache_blocks, 1);
+   blocks = (PBP_Block*)calloc(num_blocks, sizeof(PBP_Block));
+   cur_block = NULL;
+   block_clock = 0;
+   last_block = -1;
+   inflater = (struct z_stream_s*)calloc(1, sizeof(z_stream));
+#ifdef HAVE_THREADS
+   workers = NULL;
+   num_workers = 0;
+   prefetch_depth = 0;
+   workers_quit = false;
+   block_lock = NULL;
+   work_cond = NULL;
+   done_cond = NULL;
+#endif
    kirk_init();
    if (!ImageOpen(path, image_memcache))
    {
    }
+#ifdef HAVE_THREADS
+   else
+      StartWorkers();
+#endif
 }
 
 CDAccess_PBP::~CDAccess_PBP()
@@ -235,229 +273,378 @@ CDAccess_PBP::~CDAccess_PBP()
    Cleanup();
 }
 
-// Note: this function makes use of the current contents(as in |=) in SubPWBuf.
-void CDAccess_PBP::MakeSubPQ(int32 lba, uint8 *SubPWBuf)
+bool CDAccess_PBP::Read_Raw_PW(uint8_t *buf, int32_t lba)
+{
+   memset(buf, 0, 96);
+   SubQ.MakeSubPQ(lba, buf);
+   return true;
+}
+
+
+int CDAccess_PBP::decompress2(struct z_stream_s *z, void *out, uint32_t *out_size, void *in, uint32_t in_size)
+{
+   int ret = 0;
+
+   if (z->zalloc == NULL) {
+      z->next_in = Z_NULL;
+      z->avail_in = 0;
+      z->zalloc = Z_NULL;
+      z->zfree = Z_NULL;
+      z->opaque = Z_NULL;
+      ret = inflateInit2(z, -15);
+   }
+   else
+      ret = inflateReset(z);
+
+   if (ret != Z_OK)
+      return ret;
+
+   z->next_in = (Bytef*)in;
+   z->avail_in = in_size;
+   z->next_out = (Bytef*)out;
+   z->avail_out = *out_size;
+
+   ret = inflate(z, Z_FINISH);
+
+   *out_size -= z->avail_out;
+   return ret == 1 ? 0 : ret;
+}
+
+CDAccess_PBP::PBP_Block *CDAccess_PBP::FindBlock(uint32_t offset)
 {
-   unsigned i;
-   uint8_t buf[0xC], adr, control;
-   int32_t track;
-   uint32_t lba_relative;
-   uint32_t ma, sa, fa;
-   uint32_t m, s, f;
-   uint8_t pause_or = 0x00;
-   bool track_found = false;
-
-   for(track = FirstTrack; track < (FirstTrack + NumTracks); track++)
+   for (unsigned i = 0; i < num_blocks; i++)
    {
-      if(lba >= (Tracks[track].LBA - Tracks[track].pregap_dv - Tracks[track].pregap) && lba < (Tracks[track].LBA + Tracks[track].sectors + Tracks[track].postgap))
-      {
-         track_found = true;
-         break;
-      }
+      if (blocks[i].state != BLOCK_EMPTY && blocks[i].offset == offset)
+         return &blocks[i];
    }
 
-   //printf("%d %d\n", Tracks[1].LBA, Tracks[1].sectors);
+   return NULL;
+}
+
+// Picks the least recently used block nobody is working on.  Queued
+// read-ahead can be taken back.
+CDAccess_PBP::PBP_Block *CDAccess_PBP::EvictBlock(void)
+{
+   PBP_Block *victim = NULL;
 
-   if(!track_found)
+   for (unsigned i = 0; i < num_blocks; i++)
    {
-      printf("MakeSubPQ error for sector %u!", lba);
-      track = FirstTrack;
+      if (blocks[i].state == BLOCK_EMPTY)
+         return &blocks[i];
+
+      if (blocks[i].state != BLOCK_BUSY && (!victim || (int32_t)(blocks[i].last_used - victim->last_used) < 0))
+         victim = &blocks[i];
    }
 
-   lba_relative = abs((int32)lba - Tracks[track].LBA);
+   victim->state = BLOCK_EMPTY;
 
-   f            = (lba_relative % 75);
-   s            = ((lba_relative / 75) % 60);
-   m            = (lba_relative / 75 / 60);
+   return victim;
+}
 
-   fa           = (lba + 150) % 75;
-   sa           = ((lba + 150) / 75) % 60;
-   ma           = ((lba + 150) / 75 / 60);
+// Reads the block's compressed data; the caller must own it(BLOCK_BUSY).
+bool CDAccess_PBP::LoadBlock(PBP_Block *blk)
+{
+   fp->seek(blk->offset, SEEK_SET);
 
-   adr          = 0x1; // Q channel data encodes position
-   control      = Tracks[track].subq_control;
+   return fp->read(blk->compressed, blk->size, false) == blk->size;
+}
 
-   // Handle pause(D7 of interleaved subchannel byte) bit, should be set to 1 when in pregap or postgap.
-   if((lba < Tracks[track].LBA) || (lba >= Tracks[track].LBA + Tracks[track].sectors))
+bool CDAccess_PBP::DecodeBlock(PBP_Block *blk, struct z_stream_s *z)
+{
+   blk->fixed_sectors = 0;
+
+   if (blk->size == sizeof(blk->compressed))
    {
-      //printf("pause_or = 0x80 --- %d\n", lba);
-      pause_or = 0x80;
+      // should be the case here?
+      memcpy(blk->raw, blk->compressed, sizeof(blk->raw));
    }
-
-   // Handle pregap between audio->data track
+   else if(is_official)
+      decompress(blk->raw[0], blk->compressed, sizeof(blk->compressed));
+   else
    {
-      int32_t pg_offset = (int32)lba - Tracks[track].LBA;
-
-      // If we're more than 2 seconds(150 sectors) from the real "start" of the track/INDEX 01, and the track is a data track,
-      // and the preceding track is an audio track, encode it as audio(by taking the SubQ control field from the preceding track).
-      //
-      // TODO: Look into how we're supposed to handle subq control field in the four combinations of track types(data/audio).
-      //
-      if(pg_offset < -150)
+      uint32_t cdbuffer_size_expect = sizeof(blk->raw);
+      uint32_t cdbuffer_size = cdbuffer_size_expect;
+      int ret = decompress2(z, blk->raw[0], &cdbuffer_size, blk->compressed, blk->size);
+      if (ret != 0)
       {
-         if((Tracks[track].subq_control & SUBQ_CTRLF_DATA) && (FirstTrack < track) && !(Tracks[track - 1].subq_control & SUBQ_CTRLF_DATA))
-         {
-            //printf("Pregap part 1 audio->data: lba=%d track_lba=%d\n", lba, Tracks[track].LBA);
-            control = Tracks[track - 1].subq_control;
-         }
+         log_cb(RETRO_LOG_ERROR, "[PBP] uncompress failed with %d for block at %#x (%u)\n", ret, blk->offset, blk->size);
+         return false;
+      }
+      if (cdbuffer_size != cdbuffer_size_expect)
+      {
+         log_cb(RETRO_LOG_WARN, "[PBP] cdbuffer_size: %lu != %lu, block at %#x\n", cdbuffer_size, cdbuffer_size_expect, blk->offset);
+         return false;
       }
    }
 
-   memset(buf, 0, 0xC);
-   buf[0] = (adr << 0) | (control << 4);
-   buf[1] = U8_to_BCD(track);
+   return true;
+}
 
-   if(lba < Tracks[track].LBA) // Index is 00 in pregap
-      buf[2] = U8_to_BCD(0x00);
-   else
-      buf[2] = U8_to_BCD(0x01);
+// Returns the decompressed block, or NULL if it can't be read.
+CDAccess_PBP::PBP_Block *CDAccess_PBP::GetBlock(int32_t block)
+{
+   uint32_t start_byte = index_table[block];
+   uint32_t size = index_table[block+1] - start_byte;
+   bool sequential = (block == last_block + 1);
+   PBP_Block *blk;
 
-   /* Track relative MSF address */
-   buf[3] = U8_to_BCD(m);
-   buf[4] = U8_to_BCD(s);
-   buf[5] = U8_to_BCD(f);
-   buf[6] = 0;
-   /* Absolute MSF address */
-   buf[7] = U8_to_BCD(ma);
-   buf[8] = U8_to_BCD(sa);
-   buf[9] = U8_to_BCD(fa);
+   // Only this thread assigns blocks to slots, so the last one can't have
+   // been taken away.
+   if (cur_block && block == last_block && cur_block->offset == start_byte)
+      return cur_block;
 
-   subq_generate_checksum(buf);
+   if (size > sizeof(blk->compressed))
+   {
+      log_cb(RETRO_LOG_ERROR, "[PBP] block %d is too large (%u)\n", block, size);
+      return NULL;
+   }
+
+#ifdef HAVE_THREADS
+   if (num_workers)
+      slock_lock(block_lock);
+
+   // Wait out a worker that is already decompressing it
+   while ((blk = FindBlock(start_byte)) && blk->state == BLOCK_BUSY)
+      scond_wait(done_cond, block_lock);
+#else
+   blk = FindBlock(start_byte);
+#endif
+
+   if (!blk)
+   {
+      blk = EvictBlock();
+      blk->offset = start_byte;
+      blk->size = size;
+   }
+
+   blk->last_used = ++block_clock;
 
-   if(!SubQReplaceMap.empty())
+   // Not loaded yet, or still queued: don't wait for a worker
+   if (blk->state != BLOCK_READY)
    {
-      //printf("%d\n", lba);
-      std::map<uint32, cpp11_array_doodad>::const_iterator it = SubQReplaceMap.find(LBA_to_ABA(lba));
+      bool loaded = (blk->state == BLOCK_QUEUED);
+      bool ok;
 
-      if(it != SubQReplaceMap.end())
+      blk->state = BLOCK_BUSY;
+#ifdef HAVE_THREADS
+      if (num_workers)
+         slock_unlock(block_lock);
+#endif
+
+      ok = (loaded || LoadBlock(blk)) && DecodeBlock(blk, inflater);
+
+#ifdef HAVE_THREADS
+      if (num_workers)
+         slock_lock(block_lock);
+#endif
+
+      if (!ok)
       {
-         //printf("Replace: %d\n", lba);
-         memcpy(buf, it->second.data, 12);
+         blk->state = BLOCK_EMPTY;
+         blk = NULL;
       }
+      else
+         blk->state = BLOCK_READY;
    }
 
-   for (i = 0; i < 96; i++)
-      SubPWBuf[i] |= (((buf[i >> 3] >> (7 - (i & 0x7))) & 1) ? 0x40 : 0x00) | pause_or;
-}
+#ifdef HAVE_THREADS
+   if (num_workers)
+   {
+      if (blk && sequential)
+         QueuePrefetch(block);
 
-bool CDAccess_PBP::Read_Raw_PW(uint8_t *buf, int32_t lba)
-{
-   memset(buf, 0, 96);
-   MakeSubPQ(lba, buf);
-   return true;
-}
+      slock_unlock(block_lock);
+   }
+#endif
+
+   last_block = blk ? block : -1;
+   cur_block = blk;
 
+   return blk;
+}
 
-int CDAccess_PBP::decompress2(void *out, uint32_t *out_size, void *in, uint32_t in_size)
+#ifdef HAVE_THREADS
+// Called with block_lock held.
+void CDAccess_PBP::QueuePrefetch(int32_t block)
 {
-   static z_stream z;
-   int ret = 0;
+   PBP_Block *pending[16];
+   bool loaded[16];
+   unsigned count = 0;
 
-   if (z.zalloc == NULL) {
-      z.next_in = Z_NULL;
-      z.avail_in = 0;
-      z.zalloc = Z_NULL;
-      z.zfree = Z_NULL;
-      z.opaque = Z_NULL;
-      ret = inflateInit2(&z, -15);
+   for (int32_t next = block + 1; next <= block + (int32_t)prefetch_depth && next < (int32_t)index_count; next++)
+   {
+      PBP_Block *blk;
+      uint32_t size = index_table[next+1] - index_table[next];
+
+      if (size > sizeof(blk->compressed) || FindBlock(index_table[next]))
+         continue;
+
+      // Reserve it while its compressed data is read without the lock
+      blk = EvictBlock();
+      blk->offset = index_table[next];
+      blk->size = size;
+      blk->state = BLOCK_BUSY;
+      blk->last_used = ++block_clock;
+      pending[count++] = blk;
    }
-   else
-      ret = inflateReset(&z);
 
-   if (ret != Z_OK)
-      return ret;
+   if (!count)
+      return;
 
-   z.next_in = (Bytef*)in;
-   z.avail_in = in_size;
-   z.next_out = (Bytef*)out;
-   z.avail_out = *out_size;
+   slock_unlock(block_lock);
+   for (unsigned i = 0; i < count; i++)
+      loaded[i] = LoadBlock(pending[i]);
+   slock_lock(block_lock);
 
-   ret = inflate(&z, Z_FINISH);
+   for (unsigned i = 0; i < count; i++)
+      pending[i]->state = loaded[i] ? BLOCK_QUEUED : BLOCK_EMPTY;
 
-   *out_size -= z.avail_out;
-   return ret == 1 ? 0 : ret;
+   scond_broadcast(work_cond);
 }
 
-bool CDAccess_PBP::Read_Raw_Sector(uint8 *buf, int32 lba)
+void CDAccess_PBP::WorkerStart(void *arg)
 {
-   uint8_t SimuQ[0xC];
+   PBP_Worker *worker = (PBP_Worker*)arg;
 
-   int32_t block = lba >> 4;
-   sector_in_blk = lba & 0xf;
+   worker->owner->WorkerRun(worker->inflater);
+}
 
-   memset(buf + 2352, 0, 96);
-   MakeSubPQ(lba, buf + 2352);
-   subq_deinterleave(buf + 2352, SimuQ);
+void CDAccess_PBP::WorkerRun(struct z_stream_s *z)
+{
+   slock_lock(block_lock);
 
-   if (block != current_block)
+   while (!workers_quit)
    {
-      uint32_t start_byte = index_table[block];
-      uint32_t size = index_table[block+1] - start_byte;
-      bool is_compressed = true;
+      PBP_Block *next = NULL;
+      bool ok;
 
-      if (lba >= index_len * 16)
+      // Oldest queued first, which is the nearest one
+      for (unsigned i = 0; i < num_blocks; i++)
       {
-         log_cb(RETRO_LOG_ERROR, "[PBP] sector %d is past img end\n", lba);
-         return false;
+         if (blocks[i].state == BLOCK_QUEUED && (!next || (int32_t)(blocks[i].last_used - next->last_used) < 0))
+            next = &blocks[i];
       }
 
-      if (size > sizeof(buff_compressed))
+      if (!next)
       {
-         log_cb(RETRO_LOG_ERROR, "[PBP] %u: block %d is too large (%u)\n", lba, block, size);
-         return false;
+         scond_wait(work_cond, block_lock);
+         continue;
       }
-      else if(size == sizeof(buff_compressed))
-         is_compressed = false;  // should be the case here?
 
-      fp->seek(start_byte, SEEK_SET);
-      fp->read(is_compressed ? buff_compressed : buff_raw[0], size);
+      next->state = BLOCK_BUSY;
+      slock_unlock(block_lock);
+
+      ok = DecodeBlock(next, z);
+
+      slock_lock(block_lock);
+      next->state = ok ? BLOCK_READY : BLOCK_EMPTY;
+      scond_signal(done_cond);
+   }
+
+   slock_unlock(block_lock);
+}
+
+void CDAccess_PBP::StartWorkers(void)
+{
+   // Every worker can hold a block, and the reader needs one more plus some
+   // to read ahead into.
+   unsigned count = (num_blocks < 4) ? 0 : MIN(cd_pbp_prefetch_threads, (num_blocks - 2) / 2);
+
+   if (!count)
+      return;
 
-//log_cb(RETRO_LOG_DEBUG, "lba = %d, block = %u, start_byte = %#x, index_table[%i] = %#x\n", lba, block, start_byte, block, index_table[block]);
+   block_lock = slock_new();
+   work_cond  = scond_new();
+   done_cond  = scond_new();
+   workers    = (PBP_Worker*)calloc(count, sizeof(PBP_Worker));
 
-      if (is_compressed)
+   for (num_workers = 0; num_workers < count; num_workers++)
+   {
+      PBP_Worker *worker = &workers[num_workers];
+
+      worker->owner    = this;
+      worker->inflater = (struct z_stream_s*)calloc(1, sizeof(z_stream));
+      worker->thread   = sthread_create(WorkerStart, worker);
+      if (!worker->thread)
       {
-         if(is_official)
-         {
-            decompress(buff_raw[0], buff_compressed, sizeof(buff_compressed));
-            fixed_sectors = 0;
-         }
-         else
-         {
-            uint32_t cdbuffer_size_expect = sizeof(buff_raw[0]) << 4;
-            uint32_t cdbuffer_size = cdbuffer_size_expect;
-            int ret = decompress2(buff_raw[0], &cdbuffer_size, buff_compressed, size);
-            if (ret != 0)
-            {
-               log_cb(RETRO_LOG_ERROR, "[PBP] uncompress failed with %d for block %d, sector %d (%u)\n", ret, block, lba, size);
-               return false;
-            }
-            if (cdbuffer_size != cdbuffer_size_expect)
-            {
-               log_cb(RETRO_LOG_WARN, "[PBP] cdbuffer_size: %lu != %lu, sector %d\n", cdbuffer_size, cdbuffer_size_expect, lba);
-               return false;
-            }
-         }
+         free(worker->inflater);
+         break;
       }
-      current_block = block;
    }
 
+   prefetch_depth = MIN(MIN(num_workers * 4, num_blocks / 2), 16);
+
+   log_cb(RETRO_LOG_INFO, "[PBP] Caching %u blocks, %u read-ahead threads.\n", num_blocks, num_workers);
+}
+
+void CDAccess_PBP::StopWorkers(void)
+{
+   if (!workers)
+      return;
+
+   slock_lock(block_lock);
+   workers_quit = true;
+   scond_broadcast(work_cond);
+   slock_unlock(block_lock);
+
+   for (unsigned i = 0; i < num_workers; i++)
+   {
+      sthread_join(workers[i].thread);
+      if (workers[i].inflater->zalloc)
+         inflateEnd(workers[i].inflater);
+      free(workers[i].inflater);
+   }
+
+   free(workers);
+   workers     = NULL;
+   num_workers = 0;
+
+   slock_free(block_lock);
+   scond_free(work_cond);
+   scond_free(done_cond);
+   block_lock = NULL;
+   work_cond  = NULL;
+   done_cond  = NULL;
+}
+#endif
+
+bool CDAccess_PBP::Read_Raw_Sector(uint8 *buf, int32 lba)
+{
+   int32_t block = lba >> 4;
+   uint32_t sector_in_blk = lba & 0xf;
+   PBP_Block *blk;
+
+   memset(buf + 2352, 0, 96);
+   SubQ.MakeSubPQ(lba, buf + 2352);
+
+   if (lba >= index_len * 16)
+   {
+      log_cb(RETRO_LOG_ERROR, "[PBP] sector %d is past img end\n", lba);
+      return false;
+   }
+
+   blk = GetBlock(block);
+   if (!blk)
+      return false;
+
    if(is_official)
    {
       // this will probably rarely get caught but better than trying to do it every time I guess...
-      if(!(fixed_sectors & (0x1 << sector_in_blk)))
+      if(!(blk->fixed_sectors & (0x1 << sector_in_blk)))
       {
-         if(fix_sector(buff_raw[sector_in_blk], lba) != 0)
+         if(fix_sector(blk->raw[sector_in_blk], lba) != 0)
             log_cb(RETRO_LOG_WARN, "[PBP] Failed to fix sector %d\n", lba);
          else
-            fixed_sectors |= (0x1 << sector_in_blk);
+            blk->fixed_sectors |= (0x1 << sector_in_blk);
       }
    }
 
-   memcpy(buf, buff_raw[sector_in_blk], 2352);
+   memcpy(buf, blk->raw[sector_in_blk], 2352);
 
    return true;
 }
 
+
 bool CDAccess_PBP::Read_TOC(TOC *toc)
 {
    struct {
@@ -479,6 +666,7 @@ bool CDAccess_PBP::Read_TOC(TOC *toc)
 
    int i;
    int32_t sector_count = 0;
+   bool had_sbi;
 
    uint32_t read_offset;
    uint32_t toc_offset = 0x400;
@@ -616,8 +804,9 @@ bool CDAccess_PBP::Read_TOC(TOC *toc)
    read_offset = index_table_offset;
 
    // set class variables
-   fixed_sectors = 0;
-   current_block = (uint32_t)-1;
+   // Cached blocks stay valid, they're keyed by file offset
+   cur_block = NULL;
+   last_block = -1;
    index_len = 0xAFC80 / sizeof(index_entry);   // disc map table has a fixed size of 0xAFC80 (22500 entries)?
 
    if(index_table != NULL)
@@ -644,6 +833,7 @@ bool CDAccess_PBP::Read_TOC(TOC *toc)
       index_table[i] = cdimg_base + index_entry.offset;
    }
    index_table[i] = cdimg_base + index_entry.offset + index_entry.size;
+   index_count = i;
 
    toc->tracks[100].lba = total_sectors;
    toc->tracks[100].adr = ADR_CURPOS;
@@ -659,18 +849,14 @@ bool CDAccess_PBP::Read_TOC(TOC *toc)
    if(PBP_DiscCount > 1 && PBP_DiscCount < 10)
       sbi_path[sbi_path.length()-5] = (CD_SelectedDisc+1) + '0';
 
+   had_sbi = SubQ.ReplaceCount() != 0;
+   SubQ.Build(Tracks, FirstTrack, NumTracks, total_sectors);
+
    // Load SBI file, if present
    if (filestream_exists(sbi_path.c_str()))
-   {
-      if(!SubQReplaceMap.empty())
-         SubQReplaceMap.clear();
-
       LoadSBI(sbi_path.c_str());
-   }
-   else if (!SubQReplaceMap.empty())
+   else if (had_sbi)
    {
-      SubQReplaceMap.clear();
-
       // SBI should probably be loaded in this case but file path is invalid
       log_cb(RETRO_LOG_WARN, "[PBP] Invalid path/filename for SBI file %s\n", sbi_path.c_str());
    }
@@ -714,11 +900,11 @@ int CDAccess_PBP::LoadSBI(const char* sbi_path)
 
       uint32 aba = AMSF_to_ABA(BCD_to_U8(ed[0]), BCD_to_U8(ed[1]), BCD_to_U8(ed[2]));
 
-      memcpy(SubQReplaceMap[aba].data, tmpq, 12);
+      SubQ.Replace(aba, tmpq);
    }
 
 #if 0
-   MDFN_printf(_("Loaded Q subchannel replacements for %zu sectors.\n"), SubQReplaceMap.size());
+   MDFN_printf(_("Loaded Q subchannel replacements for %u sectors.\n"), SubQ.ReplaceCount());
 #endif
    log_cb(RETRO_LOG_INFO, "[PBP] Loaded SBI file %s\n", sbi_path);
    filestream_close(sbis);
@@ -6,7 +6,12 @@
 #include <map>
 #include "CDAccess_Image.h"
 
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#endif
+
 class Stream;
+struct z_stream_s;
 
 class CDAccess_PBP : public CDAccess
 {
@@ -41,14 +46,70 @@ class CDAccess_PBP : public CDAccess
       uint32_t pbp_file_offsets[PBP_NUM_FILES];
 
       ////////////////
-      uint8_t buff_raw[16][2352];
-      uint8_t buff_compressed[2352 * 16];
       uint32_t *index_table;
       uint32_t index_len;
-      uint32_t current_block;
-      uint32_t sector_in_blk;
+      uint32_t index_count;   // blocks actually in the current disc's table
       ////////////////
 
+      // LRU cache of decompressed 16-sector blocks.  Blocks are keyed by their
+      // file offset, so all discs of a multi-disc EBOOT share it.
+      enum
+      {
+         BLOCK_EMPTY = 0,
+         BLOCK_QUEUED,   // compressed data loaded, waiting for a worker
+         BLOCK_BUSY,     // being loaded or decompressed
+         BLOCK_READY
+      };
+
+      struct PBP_Block
+      {
+         uint32_t offset;
+         uint32_t size;
+         uint32_t last_used;
+         uint16_t fixed_sectors;
+         int state;
+         uint8_t raw[16][2352];
+         uint8_t compressed[2352 * 16];
+      };
+
+      PBP_Block *blocks;
+      PBP_Block *cur_block;
+      unsigned num_blocks;
+      uint32_t block_clock;
+      int32_t last_block;
+      struct z_stream_s *inflater;
+
+      PBP_Block *GetBlock(int32_t block);
+      PBP_Block *FindBlock(uint32_t offset);
+      PBP_Block *EvictBlock(void);
+      bool LoadBlock(PBP_Block *blk);
+      bool DecodeBlock(PBP_Block *blk, struct z_stream_s *z);
+
+#ifdef HAVE_THREADS
+      // Read-ahead decompression.  Only this thread touches fp; workers are
+      // handed blocks whose compressed data is already loaded.
+      struct PBP_Worker
+      {
+         CDAccess_PBP *owner;
+         struct z_stream_s *inflater;
+         sthread_t *thread;
+      };
+
+      PBP_Worker *workers;
+      unsigned num_workers;
+      unsigned prefetch_depth;
+      bool workers_quit;
+      slock_t *block_lock;
+      scond_t *work_cond;   // signalled when a block is queued
+      scond_t *done_cond;   // signalled when a block is decompressed
+
+      static void WorkerStart(void *arg);
+      void WorkerRun(struct z_stream_s *z);
+      void StartWorkers(void);
+      void StopWorkers(void);
+      void QueuePrefetch(int32_t block);
+#endif
+
       int32_t NumTracks;
       int32_t FirstTrack;
       int32_t LastTrack;
@@ -59,7 +120,6 @@ class CDAccess_PBP : public CDAccess
       uint32_t discs_start_offset[5];
       uint32_t psisoimg_offset;
 
-      uint16_t fixed_sectors;
       bool is_official;    // TODO: find more consistent ways to check for used compression algorithm, compressed (and/or encrypted?) audio tracks and messed up sectors
 
       bool ImageOpen(const char *path, bool image_memcache);
@@ -67,14 +127,9 @@ class CDAccess_PBP : public CDAccess
       void Cleanup(void);
 
       CDRFILE_TRACK_INFO Tracks[100]; // Track #0(HMM?) through 99
-      struct cpp11_array_doodad
-      {
-         uint8 data[12];
-      };
-      std::map<uint32, cpp11_array_doodad> SubQReplaceMap;
-      void MakeSubPQ(int32 lba, uint8 *SubPWBuf);
+      SubQTable SubQ;
 
-      int decompress2(void *out, uint32_t *out_size, void *in, uint32_t in_size);
+      int decompress2(struct z_stream_s *z, void *out, uint32_t *out_size, void *in, uint32_t in_size);
 
       int decode_range(unsigned int *range, unsigned int *code, unsigned char **src);
       int decode_bit(unsigned int *range, unsigned int *code, int *index, unsigned char **src, unsigned char *c);
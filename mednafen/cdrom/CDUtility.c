@@ -113,6 +113,35 @@ void encode_mode1_sector(uint32_t aba, uint8_t *sector_data)
    lec_encode_mode1_sector(aba, sector_data);
 }
 
+void encode_mode1_sector_no_ecc(uint32_t aba, uint8_t *sector_data)
+{
+   CDUtility_Init();
+
+   lec_encode_mode1_sector_no_ecc(aba, sector_data);
+}
+
+void encode_mode1_sector_ecc(uint8_t *sector_data)
+{
+   CDUtility_Init();
+
+   lec_encode_mode1_ecc(sector_data);
+}
+
+bool mode1_sector_ecc_missing(const uint8_t *sector_data)
+{
+   unsigned i;
+
+   if(sector_data[12 + 3] != 0x1)
+      return(false);
+
+   /* P parity, 2076 to 2248 */
+   for(i = 2076; i < 2248; i++)
+      if(sector_data[i])
+         return(false);
+
+   return(true);
+}
+
 void encode_mode2_sector(uint32_t aba, uint8_t *sector_data)
 {
    CDUtility_Init();
@@ -176,6 +176,15 @@ void encode_mode2_sector(uint32_t aba, uint8_t *sector_data);	// 2336 bytes of u
 void encode_mode2_form1_sector(uint32_t aba, uint8_t *sector_data);	// 2048+8 bytes of user data at offset 16
 void encode_mode2_form2_sector(uint32_t aba, uint8_t *sector_data);	// 2324+8 bytes of user data at offset 16
 
+// Mode 1 encoding with the L-EC(P/Q parity) step split off, for when the raw
+// sector is unlikely to be looked at past the EDC; the parity is left zeroed.
+void encode_mode1_sector_no_ecc(uint32_t aba, uint8_t *sector_data);	// 2048 bytes of user data at offset 16
+void encode_mode1_sector_ecc(uint8_t *sector_data);
+
+// Returns true for a mode 1 sector from encode_mode1_sector_no_ecc(), whose P parity is all zero(in practice impossible for a
+// real sector, the header alone makes it non-zero).
+bool mode1_sector_ecc_missing(const uint8_t *sector_data);
+
 
 // out_buf must be able to contain 2352+96 bytes.
 // "mode" is only used if(toc.tracks[100].control & 0x4)
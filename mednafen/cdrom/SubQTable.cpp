@@ -0,0 +1,199 @@
+/* Mednafen - Multi-system Emulator
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../mednafen.h"
+
+#include "CDAccess.h"
+#include "CDAccess_Image.h"
+#include "CDUtility.h"
+#include "SubQTable.h"
+
+// The 8 interleaved subchannel bytes(Q in D6) each byte of Q data expands to.
+static uint8_t subq_expand[256][8];
+static bool subq_expand_init = false;
+
+SubQTable::SubQTable() : entries(NULL), entry_count(0), replace_count(0), Tracks(NULL), FirstTrack(0), NumTracks(0)
+{
+   unsigned i, j;
+
+   if(subq_expand_init)
+      return;
+
+   for(i = 0; i < 256; i++)
+      for(j = 0; j < 8; j++)
+         subq_expand[i][j] = ((i >> (7 - j)) & 1) ? 0x40 : 0x00;
+
+   subq_expand_init = true;
+}
+
+SubQTable::~SubQTable()
+{
+   if(entries)
+      free(entries);
+}
+
+void SubQTable::MakeEntry(int32_t lba, Entry *e) const
+{
+   uint8_t adr, control;
+   int32_t track;
+   uint32_t lba_relative;
+   uint32_t ma, sa, fa;
+   uint32_t m, s, f;
+   bool track_found = false;
+
+   for(track = FirstTrack; track < (FirstTrack + NumTracks); track++)
+   {
+      if(lba >= (Tracks[track].LBA - Tracks[track].pregap_dv - Tracks[track].pregap) 
+            && lba < (Tracks[track].LBA + Tracks[track].sectors + Tracks[track].postgap))
+      {
+         track_found = true;
+         break;
+      }
+   }
+
+   if(!track_found)
+      track = FirstTrack;
+
+   e->track     = track_found ? track : -1;
+   e->pause_or  = 0x00;
+
+   lba_relative = abs((int32)lba - Tracks[track].LBA);
+
+   f            = (lba_relative % 75);
+   s            = ((lba_relative / 75) % 60);
+   m            = (lba_relative / 75 / 60);
+
+   fa           = (lba + 150) % 75;
+   sa           = ((lba + 150) / 75) % 60;
+   ma           = ((lba + 150) / 75 / 60);
+
+   adr          = 0x1; // Q channel data encodes position
+   control      = Tracks[track].subq_control;
+
+   // Handle pause(D7 of interleaved subchannel byte) bit, should be set to 1 when in pregap or postgap.
+   if((lba < Tracks[track].LBA) || (lba >= Tracks[track].LBA + Tracks[track].sectors))
+      e->pause_or = 0x80;
+
+   // Handle pregap between audio->data track
+   {
+      int32_t pg_offset = (int32)lba - Tracks[track].LBA;
+
+      // If we're more than 2 seconds(150 sectors) from the real "start" of the track/INDEX 01, and the track is a data track,
+      // and the preceding track is an audio track, encode it as audio(by taking the SubQ control field from the preceding track).
+      //
+      // TODO: Look into how we're supposed to handle subq control field in the four combinations of track types(data/audio).
+      //
+      if(pg_offset < -150)
+      {
+         if((Tracks[track].subq_control & SUBQ_CTRLF_DATA) && (FirstTrack < track) && !(Tracks[track - 1].subq_control & SUBQ_CTRLF_DATA))
+            control = Tracks[track - 1].subq_control;
+      }
+   }
+
+   memset(e->q, 0, 0xC);
+   e->q[0] = (adr << 0) | (control << 4);
+   e->q[1] = U8_to_BCD(track);
+
+   if(lba < Tracks[track].LBA) // Index is 00 in pregap
+      e->q[2] = U8_to_BCD(0x00);
+   else
+      e->q[2] = U8_to_BCD(0x01);
+
+   /* Track relative MSF address */
+   e->q[3] = U8_to_BCD(m);
+   e->q[4] = U8_to_BCD(s);
+   e->q[5] = U8_to_BCD(f);
+   e->q[6] = 0;
+   /* Absolute MSF address */
+   e->q[7] = U8_to_BCD(ma);
+   e->q[8] = U8_to_BCD(sa);
+   e->q[9] = U8_to_BCD(fa);
+
+   subq_generate_checksum(e->q);
+}
+
+void SubQTable::Build(const CDRFILE_TRACK_INFO *tracks, int32_t first_track, int32_t num_tracks, int32_t end_lba)
+{
+   uint32_t count = (end_lba > -150) ? LBA_to_ABA(end_lba) : 0;
+   uint32_t aba;
+
+   Tracks        = tracks;
+   FirstTrack    = first_track;
+   NumTracks     = num_tracks;
+   replace_count = 0;
+
+   if(count != entry_count)
+   {
+      if(entries)
+         free(entries);
+
+      entries     = count ? (Entry*)malloc(count * sizeof(Entry)) : NULL;
+      entry_count = entries ? count : 0;
+   }
+
+   // One pass over the disc is a lot cheaper than the per-read track search
+   // it replaces; a 74 minute disc is a few MB.
+   for(aba = 0; aba < entry_count; aba++)
+      MakeEntry(ABA_to_LBA(aba), &entries[aba]);
+}
+
+void SubQTable::Replace(uint32_t aba, const uint8_t *subq_buf)
+{
+   if(aba >= entry_count)
+      return;
+
+   memcpy(entries[aba].q, subq_buf, 12);
+   replace_count++;
+}
+
+// Note: this function makes use of the current contents(as in |=) in SubPWBuf.
+int32_t SubQTable::MakeSubPQ(int32_t lba, uint8_t *SubPWBuf)
+{
+   const Entry *e;
+   Entry tmp;
+   unsigned i, j;
+
+   if((uint32_t)LBA_to_ABA(lba) < entry_count)
+      e = &entries[LBA_to_ABA(lba)];
+   else
+   {
+      // Outside the disc(or before the first Build()); only the lead-out
+      // gets here normally.
+      if(!Tracks)
+         return -1;
+
+      MakeEntry(lba, &tmp);
+      e = &tmp;
+   }
+
+   if(e->track < 0)
+      printf("MakeSubPQ error for sector %u!", lba);
+
+   for(i = 0; i < 12; i++)
+   {
+      const uint8_t *x = subq_expand[e->q[i]];
+
+      for(j = 0; j < 8; j++)
+         SubPWBuf[i * 8 + j] |= x[j] | e->pause_or;
+   }
+
+   return e->track;
+}
@@ -0,0 +1,51 @@
+#ifndef __MDFN_CDROM_SUBQTABLE_H
+#define __MDFN_CDROM_SUBQTABLE_H
+
+#include <stdint.h>
+
+struct CDRFILE_TRACK_INFO;
+
+// Q subchannel data for every sector of a disc image, worked out once from
+// the track list(and SBI file) instead of on every sector read.
+class SubQTable
+{
+   public:
+
+      SubQTable();
+      ~SubQTable();
+
+      // Precomputes the Q data for the sectors from the start of the lead-in
+      // pregap(LBA -150) up to end_lba. Drops any earlier replacements.
+      // tracks must stay valid for as long as the table is used.
+      void Build(const CDRFILE_TRACK_INFO *tracks, int32_t first_track, int32_t num_tracks, int32_t end_lba);
+
+      // Overrides the Q data of a sector, for SBI files.
+      void Replace(uint32_t aba, const uint8_t *subq_buf);
+      unsigned ReplaceCount(void) const { return replace_count; }
+
+      // ORs the simulated P and Q subchannel data into SubPWBuf.
+      // Returns the track lba lies in, or -1 if it isn't in any(the Q data is
+      // then that of the first track).
+      int32_t MakeSubPQ(int32_t lba, uint8_t *SubPWBuf);
+
+   private:
+
+      struct Entry
+      {
+         uint8_t q[12];
+         int8_t track;
+         uint8_t pause_or;
+      };
+
+      void MakeEntry(int32_t lba, Entry *e) const;
+
+      Entry *entries;
+      uint32_t entry_count;
+      unsigned replace_count;
+
+      const CDRFILE_TRACK_INFO *Tracks;
+      int32_t FirstTrack;
+      int32_t NumTracks;
+};
+
+#endif
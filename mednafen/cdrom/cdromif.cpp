@@ -31,7 +31,12 @@
 
 #include <libretro.h>
 
+#if HAVE_THREADS && !defined(__GNUC__) && !defined(__clang__)
+#include <atomic>
+#endif
+
 extern retro_log_printf_t log_cb;
+extern struct retro_perf_callback perf_cb;
 
 enum
 {
@@ -81,14 +86,58 @@ class CDIF_Queue
 };
 
 
+// Single-producer/single-consumer ordering helpers for the rings shared by the emu and read threads.
+#if defined(__GNUC__) || defined(__clang__)
+static INLINE uint32 cdif_load(const uint32 *p)
+{
+   return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+}
+
+static INLINE void cdif_store(uint32 *p, uint32 v)
+{
+   __atomic_store_n(p, v, __ATOMIC_RELEASE);
+}
+
+static INLINE void cdif_fence(void)
+{
+   __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+#else
+static INLINE uint32 cdif_load(const uint32 *p)
+{
+   uint32 v = *(const volatile uint32 *)p;
+   std::atomic_thread_fence(std::memory_order_acquire);
+   return v;
+}
+
+static INLINE void cdif_store(uint32 *p, uint32 v)
+{
+   std::atomic_thread_fence(std::memory_order_release);
+   *(volatile uint32 *)p = v;
+}
+
+static INLINE void cdif_fence(void)
+{
+   std::atomic_thread_fence(std::memory_order_seq_cst);
+}
+#endif
+
+// A sector slot is a small seqlock: "seq" is odd while the read thread is rewriting it, and a reader
+// that sees "seq" change across its copy throws the copy away.
 typedef struct
 {
-   bool valid;
+   uint32 seq;
+   uint32 lba;	// ~0U if the slot is empty.
    bool error;
-   uint32 lba;
    uint8 data[2352 + 96];
 } CDIF_Sector_Buffer;
 
+typedef struct
+{
+   uint32 message;
+   uint32 arg;
+} CDIF_Request;
+
 /* TODO: prohibit copy constructor */
 class CDIF_MT : public CDIF
 {
@@ -105,6 +154,8 @@ class CDIF_MT : public CDIF
       // Returns false on failure(usually drive error of some kind; not completely fatal, can try again).
       virtual bool Eject(bool eject_status);
 
+      virtual bool GetStats(CDIF_Stats *stats);
+
       // FIXME: Semi-private:
       int ReadThreadStart(void);
 
@@ -113,28 +164,57 @@ class CDIF_MT : public CDIF
       CDAccess  *disc_cdaccess;
       sthread_t *CDReadThread;
 
-      // Queue for messages to the read thread.
-      CDIF_Queue ReadThreadQueue;
-
       // Queue for messages to the emu thread.
       CDIF_Queue EmuThreadQueue;
 
+      // Requests to the read thread.  Only the emu thread writes RQWritePos, and only the read thread writes RQReadPos;
+      // both count up freely.
+      enum { RQSize = 64 };
+      CDIF_Request Requests[RQSize];
+      uint32 RQWritePos;
+      uint32 RQReadPos;
+
+      void PushRequest(uint32 message, uint32 arg = 0);
 
+      // Sector ring, indexed by LBA modulo its size so a lookup is a single slot.  The read-ahead window never
+      // exceeds a quarter of it, so the sectors around the one being read are never evicted by read-ahead.
       enum { SBSize = 256 };
       CDIF_Sector_Buffer SectorBuffers[SBSize];
 
-      uint32 SBWritePos;
+      bool TryReadSector(uint8 *buf, uint32 lba, bool *error_condition);
 
+      // Only taken to sleep when one thread has to wait for the other.
       slock_t *SBMutex;
-      scond_t *SBCond;
+      scond_t *SBCond;	// Emu thread waits for a sector, or for room in Requests.
+      scond_t *RTCond;	// Read thread waits for a request.
+      uint32 EmuWaiting;
+      uint32 RTWaiting;
+
+      // Emu-thread-only statistics.
+      uint64 StatHits;
+      uint64 StatMisses;
+      uint64 StatStallUs;
+      uint64 StatMaxStallUs;
+
+      // Read-thread-written statistics.
+      uint32 StatSectorsRead;
+      uint32 StatDepth;
 
       //
       // Read-thread-only:
       //
       bool RT_EjectDisc(bool eject_status, bool skip_actual_eject = false);
+      void RT_Request(uint32 new_lba);
+      void RT_ReadSector(uint32 lba);
+      void RT_WakeEmu(void);
+      void RT_Sleep(void);
 
-      uint32 ra_lba;
-      int ra_count;
+      enum { RAMin = 2, RAMax = SBSize / 4 };
+
+      uint32 ra_lba;	// Next sector to read ahead.
+      uint32 ra_end;	// Read ahead up to, but not including, this sector.
+      uint32 ra_depth;	// Sectors to read past the last requested one.
+      uint32 ra_run;	// Sequential requests since the depth last changed.
       uint32 last_read_lba;
 };
 
@@ -276,11 +356,14 @@ bool CDIF_MT::RT_EjectDisc(bool eject_status, bool skip_actual_eject)
          }
       }
 
-      SBWritePos = 0;
+      // The emu thread is blocked in Eject() or the constructor, so nothing is reading the slots.
       ra_lba = 0;
-      ra_count = 0;
+      ra_end = 0;
+      ra_depth = RAMin;
+      ra_run = 0;
       last_read_lba = ~0U;
-      memset(SectorBuffers, 0, SBSize * sizeof(CDIF_Sector_Buffer));
+      for(int i = 0; i < SBSize; i++)
+         SectorBuffers[i].lba = ~0U;
    }
 
    return true;
@@ -298,15 +381,82 @@ static int ReadThreadStart_C(void *v_arg)
    return args->cdif_ptr->ReadThreadStart();
 }
 
+// Adapts the read-ahead depth to the access pattern: sequential runs(FMV, XA streaming) double it each time a run
+// outlasts it, while seeks halve it, so scattered file loads don't waste reads on sectors that won't be used.
+void CDIF_MT::RT_Request(uint32 new_lba)
+{
+   if(last_read_lba != ~0U && new_lba == (last_read_lba + 1))
+   {
+      if(++ra_run >= ra_depth && ra_depth < RAMax)
+      {
+         ra_depth = MIN(ra_depth * 2, (uint32)RAMax);
+         ra_run = 0;
+      }
+   }
+   else if(new_lba != last_read_lba)
+   {
+      ra_depth = MAX(ra_depth / 2, (uint32)RAMin);
+      ra_run = 0;
+      ra_lba = new_lba;
+   }
+
+   if(ra_lba < new_lba)
+      ra_lba = new_lba;
+
+   ra_end = new_lba + 1 + ra_depth;
+   last_read_lba = new_lba;
+
+   cdif_store(&StatDepth, ra_depth);
+}
+
+void CDIF_MT::RT_ReadSector(uint32 lba)
+{
+   CDIF_Sector_Buffer *sb = &SectorBuffers[lba % SBSize];
+   uint32 seq = sb->seq;
+
+   cdif_store(&sb->seq, seq + 1);
+   cdif_fence();
+
+   sb->lba = lba;
+   sb->error = false;
+   disc_cdaccess->Read_Raw_Sector(sb->data, lba);
+
+   cdif_store(&sb->seq, seq + 2);
+   cdif_store(&StatSectorsRead, StatSectorsRead + 1);
+}
+
+void CDIF_MT::RT_WakeEmu(void)
+{
+   cdif_fence();
+
+   if(cdif_load(&EmuWaiting))
+   {
+      slock_lock((slock_t*)SBMutex);
+      scond_signal((scond_t*)SBCond);
+      slock_unlock((slock_t*)SBMutex);
+   }
+}
+
+void CDIF_MT::RT_Sleep(void)
+{
+   slock_lock((slock_t*)SBMutex);
+
+   cdif_store(&RTWaiting, 1);
+   cdif_fence();
+
+   if(cdif_load(&RQWritePos) == RQReadPos)
+      scond_wait((scond_t*)RTCond, (slock_t*)SBMutex);
+
+   cdif_store(&RTWaiting, 0);
+
+   slock_unlock((slock_t*)SBMutex);
+}
+
 int CDIF_MT::ReadThreadStart()
 {
    bool Running = true;
 
    DiscEjected = true;
-   SBWritePos = 0;
-   ra_lba = 0;
-   ra_count = 0;
-   last_read_lba = ~0U;
 
    RT_EjectDisc(false, true);
 
@@ -314,93 +464,71 @@ int CDIF_MT::ReadThreadStart()
 
    while(Running)
    {
-      CDIF_Message msg;
+      uint32 write_pos = cdif_load(&RQWritePos);
 
-      // Only do a blocking-wait for a message if we don't have any sectors to read-ahead.
-      // MDFN_DispMessage("%d %d %d\n", last_read_lba, ra_lba, ra_count);
-      if(ReadThreadQueue.Read(&msg, ra_count ? false : true))
+      if(RQReadPos != write_pos)
       {
-         switch(msg.message)
+         do
          {
-            case CDIF_MSG_DIEDIEDIE:
-               Running = false;
-               break;
-
-            case CDIF_MSG_EJECT:
-               RT_EjectDisc(msg.args[0]);
-               EmuThreadQueue.Write(CDIF_Message(CDIF_MSG_DONE));
-               break;
-
-            case CDIF_MSG_READ_SECTOR:
-               {
-                  static const int       max_ra = 16;
-                  static const int   initial_ra = 1;
-                  static const int speedmult_ra = 2;
-                  uint32_t              new_lba = msg.args[0];
-
-                  assert((unsigned int)max_ra < (SBSize / 4));
-
-                  if(last_read_lba != ~0U && new_lba == (last_read_lba + 1))
-                  {
-                     int how_far_ahead = ra_lba - new_lba;
-
-                     if(how_far_ahead <= max_ra)
-                        ra_count = MIN(speedmult_ra, 1 + max_ra - how_far_ahead);
-                     else
-                        ra_count++;
-                  }
-                  else if(new_lba != last_read_lba)
-                  {
-                     ra_lba = new_lba;
-                     ra_count = initial_ra;
-                  }
-
-                  last_read_lba = new_lba;
-               }
-               break;
-         }
-      }
-
-      // Don't read >= the "end" of the disc, silly snake.  Slither.
-      if(ra_count && ra_lba == disc_toc.tracks[100].lba)
-      {
-         ra_count = 0;
-         //printf("Ephemeral scarabs: %d!\n", ra_lba);
-      }
-
-      if(ra_count)
-      {
-         uint8_t tmpbuf[2352 + 96];
-         bool error_condition = false;
+            const CDIF_Request rq = Requests[RQReadPos % RQSize];
 
-         disc_cdaccess->Read_Raw_Sector(tmpbuf, ra_lba);
+            cdif_store(&RQReadPos, RQReadPos + 1);
 
-         slock_lock((slock_t*)SBMutex);
+            switch(rq.message)
+            {
+               case CDIF_MSG_DIEDIEDIE:
+                  Running = false;
+                  break;
+
+               case CDIF_MSG_EJECT:
+                  RT_EjectDisc(rq.arg);
+                  EmuThreadQueue.Write(CDIF_Message(CDIF_MSG_DONE));
+                  break;
+
+               case CDIF_MSG_READ_SECTOR:
+                  RT_Request(rq.arg);
+                  break;
+            }
+         } while(Running && RQReadPos != write_pos);
 
-         SectorBuffers[SBWritePos].lba = ra_lba;
-         memcpy(SectorBuffers[SBWritePos].data, tmpbuf, 2352 + 96);
-         SectorBuffers[SBWritePos].valid = true;
-         SectorBuffers[SBWritePos].error = error_condition;
-         SBWritePos = (SBWritePos + 1) % SBSize;
+         // There's room in Requests again.
+         RT_WakeEmu();
+         continue;
+      }
 
-         scond_signal((scond_t*)SBCond);
-         slock_unlock((slock_t*)SBMutex);
+      // Skip what's still buffered from earlier, and don't read >= the "end" of the disc, silly snake.  Slither.
+      while(ra_lba < ra_end && ra_lba < disc_toc.tracks[100].lba && SectorBuffers[ra_lba % SBSize].lba == ra_lba)
+         ra_lba++;
 
+      if(ra_lba < ra_end && ra_lba < disc_toc.tracks[100].lba)
+      {
+         RT_ReadSector(ra_lba);
+         RT_WakeEmu();
          ra_lba++;
-         ra_count--;
       }
+      else
+         RT_Sleep();
    }
 
    return(1);
 }
 
-CDIF_MT::CDIF_MT(CDAccess *cda) : disc_cdaccess(cda), CDReadThread(NULL), SBMutex(NULL), SBCond(NULL)
+CDIF_MT::CDIF_MT(CDAccess *cda) : disc_cdaccess(cda), CDReadThread(NULL), RQWritePos(0), RQReadPos(0),
+   SBMutex(NULL), SBCond(NULL), RTCond(NULL), EmuWaiting(0), RTWaiting(0),
+   StatHits(0), StatMisses(0), StatStallUs(0), StatMaxStallUs(0), StatSectorsRead(0), StatDepth(RAMin)
 {
    CDIF_Message msg;
    RTS_Args s;
 
+   for(int i = 0; i < SBSize; i++)
+   {
+      SectorBuffers[i].seq = 0;
+      SectorBuffers[i].lba = ~0U;
+   }
+
    SBMutex            = slock_new();
    SBCond             = scond_new();
+   RTCond             = scond_new();
    UnrecoverableError = false;
 
    s.cdif_ptr = this;
@@ -413,18 +541,36 @@ CDIF_MT::CDIF_MT(CDAccess *cda) : disc_cdaccess(cda), CDReadThread(NULL), SBMute
 CDIF_MT::~CDIF_MT()
 {
    bool thread_deaded_failed = false;
+   CDIF_Stats stats;
 
-   ReadThreadQueue.Write(CDIF_Message(CDIF_MSG_DIEDIEDIE));
+   PushRequest(CDIF_MSG_DIEDIEDIE);
 
    if(!thread_deaded_failed)
       sthread_join((sthread_t*)CDReadThread);
 
+   if(GetStats(&stats) && (stats.hits + stats.misses))
+      log_cb(RETRO_LOG_INFO, "[CDIF] %llu of %llu sector reads buffered, %llu ms stalled (longest %llu ms), %u sectors read.\n",
+            (unsigned long long)stats.hits, (unsigned long long)(stats.hits + stats.misses),
+            (unsigned long long)(stats.stall_us / 1000), (unsigned long long)(stats.max_stall_us / 1000), stats.sectors_read);
+
    if(SBMutex)
    {
       slock_free((slock_t*)SBMutex);
       SBMutex = NULL;
    }
 
+   if(SBCond)
+   {
+      scond_free((scond_t*)SBCond);
+      SBCond = NULL;
+   }
+
+   if(RTCond)
+   {
+      scond_free((scond_t*)RTCond);
+      RTCond = NULL;
+   }
+
    if(disc_cdaccess)
    {
       delete disc_cdaccess;
@@ -432,10 +578,60 @@ CDIF_MT::~CDIF_MT()
    }
 }
 
+void CDIF_MT::PushRequest(uint32 message, uint32 arg)
+{
+   const uint32 write_pos = RQWritePos;
+
+   if((write_pos - cdif_load(&RQReadPos)) == RQSize)
+   {
+      slock_lock((slock_t*)SBMutex);
+
+      cdif_store(&EmuWaiting, 1);
+      cdif_fence();
+
+      while((write_pos - cdif_load(&RQReadPos)) == RQSize)
+         scond_wait((scond_t*)SBCond, (slock_t*)SBMutex);
+
+      cdif_store(&EmuWaiting, 0);
+
+      slock_unlock((slock_t*)SBMutex);
+   }
+
+   Requests[write_pos % RQSize].message = message;
+   Requests[write_pos % RQSize].arg = arg;
+   cdif_store(&RQWritePos, write_pos + 1);
+
+   cdif_fence();
+
+   if(cdif_load(&RTWaiting))
+   {
+      slock_lock((slock_t*)SBMutex);
+      scond_signal((scond_t*)RTCond);
+      slock_unlock((slock_t*)SBMutex);
+   }
+}
+
+bool CDIF_MT::TryReadSector(uint8 *buf, uint32 lba, bool *error_condition)
+{
+   CDIF_Sector_Buffer *sb = &SectorBuffers[lba % SBSize];
+   const uint32 seq = cdif_load(&sb->seq);
+
+   if((seq & 1) || sb->lba != lba)
+      return false;
+
+   *error_condition = sb->error;
+   memcpy(buf, sb->data, 2352 + 96);
+
+   cdif_fence();
+
+   return cdif_load(&sb->seq) == seq;
+}
+
 bool CDIF_MT::ReadRawSector(uint8 *buf, uint32 lba, int64 timeout_us)
 {
    bool found = false;
    bool error_condition = false;
+   retro_time_t stall_start = 0;
 
    if(UnrecoverableError)
    {
@@ -451,41 +647,56 @@ bool CDIF_MT::ReadRawSector(uint8 *buf, uint32 lba, int64 timeout_us)
       return(false);
    }
 
-   ReadThreadQueue.Write(CDIF_Message(CDIF_MSG_READ_SECTOR, lba));
+   PushRequest(CDIF_MSG_READ_SECTOR, lba);
+
+   if(TryReadSector(buf, lba, &error_condition))
+   {
+      StatHits++;
+      return(!error_condition);
+   }
+
+   StatMisses++;
+
+   if(perf_cb.get_time_usec)
+      stall_start = perf_cb.get_time_usec();
 
    slock_lock((slock_t*)SBMutex);
 
-   do
+   cdif_store(&EmuWaiting, 1);
+   cdif_fence();
+
+   while(!(found = TryReadSector(buf, lba, &error_condition)))
    {
-      int i;
-      for(i = 0; i < SBSize; i++)
+      if (timeout_us >= 0)
       {
-         if(SectorBuffers[i].valid && SectorBuffers[i].lba == lba)
+         if (!scond_wait_timeout((scond_t*)SBCond, (slock_t*)SBMutex, timeout_us))
          {
-            error_condition = SectorBuffers[i].error;
-            memcpy(buf, SectorBuffers[i].data, 2352 + 96);
-            found = true;
+            found = TryReadSector(buf, lba, &error_condition);
+            break;
          }
       }
+      else
+         scond_wait((scond_t*)SBCond, (slock_t*)SBMutex);
+   }
 
-      if(!found)
-      {
-         if (timeout_us >= 0)
-         {
-            if (!scond_wait_timeout((scond_t*)SBCond, (slock_t*)SBMutex, timeout_us))
-            {
-               error_condition = true;
-               memset(buf, 0, 2352 + 96);
-               break;
-            }
-         }
-         else
-            scond_wait((scond_t*)SBCond, (slock_t*)SBMutex);
-      }
-   } while(!found);
+   cdif_store(&EmuWaiting, 0);
 
    slock_unlock((slock_t*)SBMutex);
 
+   if(perf_cb.get_time_usec)
+   {
+      const uint64 stall = perf_cb.get_time_usec() - stall_start;
+
+      StatStallUs += stall;
+      StatMaxStallUs = MAX(StatMaxStallUs, stall);
+   }
+
+   if(!found)
+   {
+      error_condition = true;
+      memset(buf, 0, 2352 + 96);
+   }
+
    return(!error_condition);
 }
 
@@ -519,7 +730,7 @@ void CDIF_MT::HintReadSector(uint32 lba)
    if(UnrecoverableError)
       return;
 
-   ReadThreadQueue.Write(CDIF_Message(CDIF_MSG_READ_SECTOR, lba));
+   PushRequest(CDIF_MSG_READ_SECTOR, lba);
 }
 
 bool CDIF_MT::Eject(bool eject_status)
@@ -529,14 +740,33 @@ bool CDIF_MT::Eject(bool eject_status)
    if(UnrecoverableError)
       return(false);
 
-   ReadThreadQueue.Write(CDIF_Message(CDIF_MSG_EJECT, eject_status));
+   PushRequest(CDIF_MSG_EJECT, eject_status);
    EmuThreadQueue.Read(&msg);
 
    return(true);
 }
 
+bool CDIF_MT::GetStats(CDIF_Stats *stats)
+{
+   stats->hits         = StatHits;
+   stats->misses       = StatMisses;
+   stats->stall_us     = StatStallUs;
+   stats->max_stall_us = StatMaxStallUs;
+   stats->sectors_read = cdif_load(&StatSectorsRead);
+   stats->ra_depth     = cdif_load(&StatDepth);
+
+   return(true);
+}
+
 #endif /* HAVE_THREADS */
 
+bool CDIF::GetStats(CDIF_Stats *stats)
+{
+   memset(stats, 0, sizeof(*stats));
+
+   return(false);
+}
+
 bool CDIF::ValidateRawSector(uint8 *buf)
 {
    int mode = buf[12 + 3];
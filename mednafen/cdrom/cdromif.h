@@ -25,6 +25,16 @@
 
 typedef TOC CD_TOC;
 
+typedef struct
+{
+   uint64_t hits;          // Sectors that were already buffered when requested
+   uint64_t misses;        // Sectors the emulator had to wait for
+   uint64_t stall_us;      // Total time spent waiting on misses
+   uint64_t max_stall_us;  // Longest single wait
+   uint32_t sectors_read;  // Sectors read from the disc image
+   uint32_t ra_depth;      // Current read-ahead depth, in sectors
+} CDIF_Stats;
+
 class CDIF
 {
    public:
@@ -57,6 +67,9 @@ class CDIF
       // No reference counting or whatever is done, so if you destroy the CDIF object before you destroy the returned Stream, things will go BOOM.
       Stream *MakeStream(uint32_t lba, uint32_t sector_count);
 
+      // Returns false if the implementation doesn't buffer reads(and so has no statistics to report).
+      virtual bool GetStats(CDIF_Stats *stats);
+
    protected:
       bool UnrecoverableError;
       TOC disc_toc;
@@ -22,6 +22,9 @@
  */
 
 #include <stdint.h>
+#include <boolean.h>
+
+#include "edc_crc32.h"
 
 /***
  *** EDC checksum used in CDROM sectors
@@ -47,7 +50,7 @@
 /*                                                               */
 /*****************************************************************/
 
-unsigned long  edctable[256] =
+static const uint32_t edctable[256] =
 {
  0x00000000L, 0x90910101L, 0x91210201L, 0x01B00300L,
  0x92410401L, 0x02D00500L, 0x03600600L, 0x93F10701L,
@@ -115,6 +118,32 @@ unsigned long  edctable[256] =
  0x71C0FC00L, 0xE151FD01L, 0xE0E1FE01L, 0x7070FF00L
 };
 
+/*
+ * Slice-by-8 tables: edctable_slice[n][b] is the CRC of byte b followed by
+ * n zero bytes, so eight input bytes can be folded in per step.
+ */
+
+static uint32_t edctable_slice[8][256];
+static bool edctable_slice_inited = false;
+
+void EDCCrc32_Init(void)
+{
+   unsigned i, n;
+
+   if(edctable_slice_inited)
+      return;
+
+   for(i = 0; i < 256; i++)
+   {
+      edctable_slice[0][i] = edctable[i];
+
+      for(n = 1; n < 8; n++)
+         edctable_slice[n][i] = edctable[edctable_slice[n - 1][i] & 0xFF] ^ (edctable_slice[n - 1][i] >> 8);
+   }
+
+   edctable_slice_inited = true;
+}
+
 /*
  * CDROM EDC calculation
  */
@@ -123,6 +152,23 @@ uint32_t EDCCrc32(const unsigned char *data, int len)
 {
    uint32_t crc = 0;
 
+   if(!edctable_slice_inited)
+      EDCCrc32_Init();
+
+   while(len >= 8)
+   {
+      const uint32_t lo = crc ^ (data[0] | (data[1] << 8) | (data[2] << 16) | ((uint32_t)data[3] << 24));
+      const uint32_t hi = data[4] | (data[5] << 8) | (data[6] << 16) | ((uint32_t)data[7] << 24);
+
+      crc = edctable_slice[7][lo & 0xFF] ^ edctable_slice[6][(lo >> 8) & 0xFF] ^
+            edctable_slice[5][(lo >> 16) & 0xFF] ^ edctable_slice[4][lo >> 24] ^
+            edctable_slice[3][hi & 0xFF] ^ edctable_slice[2][(hi >> 8) & 0xFF] ^
+            edctable_slice[1][(hi >> 16) & 0xFF] ^ edctable_slice[0][hi >> 24];
+
+      data += 8;
+      len  -= 8;
+   }
+
    while(len--)
       crc = edctable[(crc ^ *data++) & 0xFF] ^ (crc >> 8);
 
@@ -7,6 +7,9 @@
 extern "C" {
 #endif
 
+/* Builds the lookup tables; EDCCrc32() does it on first use otherwise. */
+void EDCCrc32_Init(void);
+
 uint32_t EDCCrc32(const unsigned char*, int);
 
 #ifdef __cplusplus
@@ -20,13 +20,13 @@
 #include <assert.h>
 #include <sys/types.h>
 #include <stdint.h>
+#include <string.h>
 
 #include "lec.h"
+#include "edc_crc32.h"
 
 #define GF8_PRIM_POLY 0x11d /* x^8 + x^4 + x^3 + x^2 + 1 */
 
-#define EDC_POLY 0x8001801b /* (x^16 + x^15 + x^2 + 1) (x^16 + x^2 + x + 1) */
-
 #define LEC_HEADER_OFFSET 12
 #define LEC_DATA_OFFSET 16
 #define LEC_MODE1_DATA_LEN 2048
@@ -43,7 +43,6 @@ static uint8_t GF8_LOG[256];
 static uint8_t GF8_ILOG[256];
 
 uint16_t cf8_table[43][256];
-uint32_t crc_table[256];
 uint8_t scramble_table[2340];
 
 /* Addition in the GF(8) domain: just the XOR of the values.
@@ -71,38 +70,12 @@ static uint8_t gf8_div(uint8_t a, uint8_t b)
 }
 
 
-/* Reverses the bits in 'd'. 'bits' defines the bit width of 'd'.
- */
-static uint32_t mirror_bits(uint32_t d, int bits)
-{
-  int i;
-  uint32_t r = 0;
-
-  for (i = 0; i < bits; i++)
-  {
-    r <<= 1;
-
-    if ((d & 0x1) != 0)
-      r |= 0x1;
-
-    d >>= 1;
-  }
-
-  return r;
-}
-
-
-/* Calculates the CRC of given data with given lengths based on the
- * table lookup algorithm.
+/* Calculates the EDC of given data with given lengths(shared with the
+ * EDC check, see edc_crc32.c).
  */
 static uint32_t calc_edc(uint8_t *data, int len)
 {
-  uint32_t crc = 0;
-
-  while (len--)
-    crc = crc_table[(int)(crc ^ *data++) & 0xff] ^ (crc >> 8);
-
-  return crc;
+  return EDCCrc32(data, len);
 }
 
 /* Build the scramble table as defined in the yellow book. The bytes
@@ -134,34 +107,6 @@ static void scramble_table_init(void)
    }
 }
 
-/* Build the CRC lookup table for EDC_POLY poly. The CRC is 32 bit wide
- * and reversed (i.e. the bit stream is divided by the EDC_POLY with the
- * LSB first order).
- */
-static void crc_table_init(void)
-{
-   uint32_t i, j;
-   uint32_t r;
-
-   for (i = 0; i < 256; i++)
-   {
-      r = mirror_bits(i, 8);
-
-      r <<= 24;
-
-      for (j = 0; j < 8; j++)
-      {
-         r <<= 1;
-         if ((r & 0x80000000) != 0)
-            r ^= EDC_POLY;
-      }
-
-      r = mirror_bits(r, 32);
-
-      crc_table[i] = r;
-   }
-}
-
 /* Creates the logarithm and inverse logarithm table that is required
  * for performing multiplication in the GF(8) domain.
  */
@@ -265,8 +210,8 @@ static void cf8_table_init(void)
 void lec_tables_init(void)
 {
    scramble_table_init();
-   crc_table_init();
    cf8_table_init();
+   EDCCrc32_Init();
 }
 
 /* Calc EDC for a MODE 1 sector
@@ -456,22 +401,32 @@ void lec_encode_mode0_sector(uint32_t adr, uint8_t *sector)
  * offset 16
  */
 void lec_encode_mode1_sector(uint32_t adr, uint8_t *sector)
+{
+   lec_encode_mode1_sector_no_ecc(adr, sector);
+   lec_encode_mode1_ecc(sector);
+}
+
+/* Encodes a MODE 1 sector without the P and Q parity, which is left zeroed.
+ * 'adr' is the current physical sector address
+ * 'sector' must be 2352 byte wide containing 2048 bytes user data at
+ * offset 16
+ */
+void lec_encode_mode1_sector_no_ecc(uint32_t adr, uint8_t *sector)
 {
    set_sync_pattern(sector);
    set_sector_header(1, adr, sector);
 
    calc_mode1_edc(sector);
 
-   /* clear the intermediate field */
-   sector[LEC_MODE1_INTERMEDIATE_OFFSET] =
-      sector[LEC_MODE1_INTERMEDIATE_OFFSET + 1] =
-      sector[LEC_MODE1_INTERMEDIATE_OFFSET + 2] =
-      sector[LEC_MODE1_INTERMEDIATE_OFFSET + 3] =
-      sector[LEC_MODE1_INTERMEDIATE_OFFSET + 4] =
-      sector[LEC_MODE1_INTERMEDIATE_OFFSET + 5] =
-      sector[LEC_MODE1_INTERMEDIATE_OFFSET + 6] =
-      sector[LEC_MODE1_INTERMEDIATE_OFFSET + 7] = 0;
+   /* clear the intermediate field and parity */
+   memset(sector + LEC_MODE1_INTERMEDIATE_OFFSET, 0, 2352 - LEC_MODE1_INTERMEDIATE_OFFSET);
+}
 
+/* Calculates the P and Q parity of a MODE 1 sector.
+ * 'sector' must be 2352 byte wide, and encoded up to the intermediate field
+ */
+void lec_encode_mode1_ecc(uint8_t *sector)
+{
    calc_P_parity(sector);
    calc_Q_parity(sector);
 }
@@ -44,6 +44,18 @@ void lec_encode_mode0_sector(uint32_t adr, uint8_t *sector);
  */
 void lec_encode_mode1_sector(uint32_t adr, uint8_t *sector);
 
+/* Encodes a MODE 1 sector without the P and Q parity, which is left zeroed.
+ * 'adr' is the current physical sector address
+ * 'sector' must be 2352 byte wide containing 2048 bytes user data at
+ * offset 16
+ */
+void lec_encode_mode1_sector_no_ecc(uint32_t adr, uint8_t *sector);
+
+/* Calculates the P and Q parity of a sector from
+ * lec_encode_mode1_sector_no_ecc().
+ */
+void lec_encode_mode1_ecc(uint8_t *sector);
+
 /* Encodes a MODE 2 sector.
  * 'adr' is the current physical sector address
  * 'sector' must be 2352 byte wide containing 2336 bytes user data at
@@ -1037,12 +1037,16 @@ void PS_CDC::HandlePlayRead(void)
                // maybe if(!(Mode & 0x30)) too?
                if(!(buf[12 + 6] & 0x20))
                {
-                  if(!edc_lec_check_and_correct(buf, true))
+                  if(!edc_lec_check_and_correct(buf, buf[12 + 3] != 0x1))
                   {
                      MDFN_DispMessage("Bad sector? - %d", CurSector);
                   }
                }
 
+               // Cooked mode 1 images leave out the parity, which only the whole-sector modes let the program see.
+               if((Mode & 0x30) && mode1_sector_ecc_missing(buf))
+                  encode_mode1_sector_ecc(buf);
+
                if(!(Mode & 0x30) && (buf[12 + 6] & 0x20))
                   PSX_WARNING("[CDC] BORK: %d", CurSector);
 
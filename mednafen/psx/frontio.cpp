@@ -91,7 +91,7 @@ void InputDevice::SetCrosshairsColor(uint32_t color)
    chair_b = (color >>  0) & 0xFF;
 }
 
-static void crosshair_plot( uint32 *pixels,
+static void crosshair_plot( MDFN_SurfacePixel *pixels,
 							int x,
 							const MDFN_PixelFormat* const format,
 							unsigned chair_r,
@@ -126,7 +126,7 @@ static void crosshair_plot( uint32 *pixels,
 	pixels[x] = MAKECOLOR(nr, ng, nb, a);
 }
 
-INLINE void InputDevice::DrawCrosshairs(uint32 *pixels, const MDFN_PixelFormat* const format, const unsigned width, const unsigned pix_clock)
+INLINE void InputDevice::DrawCrosshairs(MDFN_SurfacePixel *pixels, const MDFN_PixelFormat* const format, const unsigned width, const unsigned pix_clock)
 {
 	switch ( chair_cursor )
 	{
@@ -254,7 +254,7 @@ bool InputDevice::RequireNoFrameskip(void)
  return false;
 }
 
-int32_t InputDevice::GPULineHook(const int32_t timestamp, bool vsync, uint32 *pixels, const MDFN_PixelFormat* const format, const unsigned width, const unsigned pix_clock_offset, const unsigned pix_clock, const unsigned pix_clock_divider)
+int32_t InputDevice::GPULineHook(const int32_t timestamp, bool vsync, MDFN_SurfacePixel *pixels, const MDFN_PixelFormat* const format, const unsigned width, const unsigned pix_clock_offset, const unsigned pix_clock, const unsigned pix_clock_divider)
 {
  return(PSX_EVENT_MAXTS);
 }
@@ -1016,7 +1016,7 @@ bool FrontIO::RequireNoFrameskip(void)
    return(false);
 }
 
-void FrontIO::GPULineHook(const int32_t timestamp, const int32_t line_timestamp, bool vsync, uint32 *pixels, const MDFN_PixelFormat* const format, const unsigned width, const unsigned pix_clock_offset, const unsigned pix_clock, const unsigned pix_clock_divider)
+void FrontIO::GPULineHook(const int32_t timestamp, const int32_t line_timestamp, bool vsync, MDFN_SurfacePixel *pixels, const MDFN_PixelFormat* const format, const unsigned width, const unsigned pix_clock_offset, const unsigned pix_clock, const unsigned pix_clock_divider)
 {
    Update(timestamp);
 
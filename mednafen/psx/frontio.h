@@ -18,12 +18,12 @@ class InputDevice
 
       virtual bool RequireNoFrameskip(void);
       // Divide mouse X coordinate by pix_clock_divider in the lightgun code to get the coordinate in pixel(clocks).
-      virtual int32_t GPULineHook(const int32_t line_timestamp, bool vsync, uint32 *pixels, const MDFN_PixelFormat* const format, const unsigned width, const unsigned pix_clock_offset, const unsigned pix_clock, const unsigned pix_clock_divider);
+      virtual int32_t GPULineHook(const int32_t line_timestamp, bool vsync, MDFN_SurfacePixel *pixels, const MDFN_PixelFormat* const format, const unsigned width, const unsigned pix_clock_offset, const unsigned pix_clock, const unsigned pix_clock_divider);
 
       virtual void Update(const int32_t timestamp);	// Partially-implemented, don't rely on for timing any more fine-grained than a video frame for now.
       virtual void ResetTS(void);
 
-      void DrawCrosshairs(uint32 *pixels, const MDFN_PixelFormat* const format, const unsigned width, const unsigned pix_clock);
+      void DrawCrosshairs(MDFN_SurfacePixel *pixels, const MDFN_PixelFormat* const format, const unsigned width, const unsigned pix_clock);
 
       virtual void SetAMCT(bool enabled);
       virtual void SetCrosshairsCursor(int cursor);
@@ -74,7 +74,7 @@ class FrontIO
       void ResetTS(void);
 
       bool RequireNoFrameskip(void);
-      void GPULineHook(const int32_t timestamp, const int32_t line_timestamp, bool vsync, uint32 *pixels, const MDFN_PixelFormat* const format, const unsigned width, const unsigned pix_clock_offset, const unsigned pix_clock, const unsigned pix_clock_divider);
+      void GPULineHook(const int32_t timestamp, const int32_t line_timestamp, bool vsync, MDFN_SurfacePixel *pixels, const MDFN_PixelFormat* const format, const unsigned width, const unsigned pix_clock_offset, const unsigned pix_clock, const unsigned pix_clock_divider);
 
       void UpdateInput(void);
       void SetInput(unsigned int port, const char *type, void *ptr);
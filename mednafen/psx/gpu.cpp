@@ -25,8 +25,19 @@
 #include "../pgxp/pgxp_gpu.h"
 #include "../pgxp/pgxp_mem.h"
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
 #include "gpu_common.h"
 
+#ifdef GPU_TRACE
+#include "gpu_trace.h"
+#include "../md5.h"
+#endif
+
 #include "gpu_polygon.cpp"
 #include "gpu_sprite.cpp"
 #include "gpu_line.cpp"
@@ -175,9 +186,17 @@ static void Command_FBFill(PS_GPU* gpu, const uint32 *cb)
    //printf("[GPU] FB Fill %d:%d w=%d, h=%d\n", destX, destY, width, height);
    gpu->DrawTimeAvail       -= 46; // Approximate
 
+   /* The fill wraps around at the right edge of VRAM, split it
+    * into (at most) two contiguous spans */
+   const unsigned ushift     = gpu->upscale_shift;
+   const uint32_t span0      = std::min<int32>(width, 1024 - destX) << ushift;
+   const uint32_t span1      = (width << ushift) - span0;
+
+   MarkDirty(gpu, destX, destY, width, height);
+
    for(y = 0; y < height; y++)
    {
-      unsigned x;
+      unsigned dy;
       const int32 d_y = (y + destY) & 511;
 
       if(LineSkipTest(gpu, d_y))
@@ -185,11 +204,13 @@ static void Command_FBFill(PS_GPU* gpu, const uint32 *cb)
 
       gpu->DrawTimeAvail -= (width >> 3) + 9;
 
-      for(x = 0; x < width; x++)
+      for(dy = 0; dy < UPSCALE(gpu); dy++)
       {
-         const int32 d_x = (x + destX) & 1023;
+         const uint32_t row = (d_y << ushift) + dy;
 
-         texel_put(d_x, d_y, fill_value);
+         vram_fill_row(gpu, destX << ushift, row, fill_value, span0);
+         if(span1)
+            vram_fill_row(gpu, 0, row, fill_value, span1);
       }
    }
 
@@ -217,31 +238,45 @@ static void Command_FBCopy(PS_GPU* g, const uint32 *cb)
 
    g->DrawTimeAvail -= (width * height) * 2;
 
+   /* Copy the rectangle row by row at the internal resolution, in
+    * chunks of 128 native pixels: each chunk is read in full before
+    * being written back, which keeps overlapping copies behaving
+    * like the real GPU. */
+   const unsigned ushift = g->upscale_shift;
+
+   MarkDirty(g, destX, destY, width, height);
+
    for(y = 0; y < height; y++)
    {
-      unsigned x;
+      unsigned dy;
+      const int32 s_y = (y + sourceY) & 511;
+      const int32 d_y = (y + destY) & 511;
 
-      for(x = 0; x < width; x += 128)
+      for(dy = 0; dy < UPSCALE(g); dy++)
       {
-         const int32 chunk_x_max = std::min<int32>(width - x, 128);
-         uint16 tmpbuf[128]; // TODO: Check and see if the GPU is actually (ab)using the CLUT or texture cache.
+         unsigned x;
+         const uint32_t s_row = (s_y << ushift) + dy;
+         const uint32_t d_row = (d_y << ushift) + dy;
 
-         for(int32 chunk_x = 0; chunk_x < chunk_x_max; chunk_x++)
+         for(x = 0; x < width; x += 128)
          {
-            int32 s_y = (y + sourceY) & 511;
-            int32 s_x = (x + chunk_x + sourceX) & 1023;
-
-            // XXX make upscaling-friendly, as it is we copy at 1x
-            tmpbuf[chunk_x] = texel_fetch(g, s_x, s_y);
-         }
-
-         for(int32 chunk_x = 0; chunk_x < chunk_x_max; chunk_x++)
-         {
-            int32 d_y = (y + destY) & 511;
-            int32 d_x = (x + chunk_x + destX) & 1023;
-
-            if(!(texel_fetch(g, d_x, d_y) & g->MaskEvalAND))
-               texel_put(d_x, d_y, tmpbuf[chunk_x] | g->MaskSetOR);
+            uint16 tmpbuf[128 << 4]; // TODO: Check and see if the GPU is actually (ab)using the CLUT or texture cache.
+            const int32 chunk_x_max = std::min<int32>(width - x, 128);
+            const int32 s_x         = (x + sourceX) & 1023;
+            const int32 d_x         = (x + destX) & 1023;
+            const int32 s_span      = std::min<int32>(chunk_x_max, 1024 - s_x);
+            const int32 d_span      = std::min<int32>(chunk_x_max, 1024 - d_x);
+
+            vram_read_row(g, s_x << ushift, s_row, tmpbuf, s_span << ushift);
+            if(s_span < chunk_x_max)
+               vram_read_row(g, 0, s_row, tmpbuf + (s_span << ushift),
+                     (chunk_x_max - s_span) << ushift);
+
+            vram_copy_row_masked(g, d_x << ushift, d_row, tmpbuf,
+                  d_span << ushift, g->MaskEvalAND, g->MaskSetOR);
+            if(d_span < chunk_x_max)
+               vram_copy_row_masked(g, 0, d_row, tmpbuf + (d_span << ushift),
+                     (chunk_x_max - d_span) << ushift, g->MaskEvalAND, g->MaskSetOR);
          }
       }
    }
@@ -644,10 +679,25 @@ void GPU_Init(bool pal_clock_and_tv,
 
    GPU.display_change_count = 0;
 
-   GPU.upscale_shift = upscale_shift;
+   memset(GPU.DirtyCur, 0, sizeof(GPU.DirtyCur));
+   memset(GPU.DirtyPrev, 0, sizeof(GPU.DirtyPrev));
+   memset(GPU.ScanoutLines, 0, sizeof(GPU.ScanoutLines));
+   GPU.ScanoutFrame   = 0;
+   GPU.ScanoutSkip    = false;
+   GPU.ScanoutChanged = true;
+
+   GPU_set_upscale_shift(upscale_shift);
    GPU.dither_upscale_shift = 0;
 
    GPU.killQuadPart = 0;
+
+#ifdef GPU_TRACE
+   {
+      const char *env = getenv("GPU_TRACE");
+      if (env)
+         gpu_trace_init(env, pal_clock_and_tv);
+   }
+#endif
 }
 
 void GPU_RecalcClockRatio(void) {
@@ -661,6 +711,10 @@ void GPU_RecalcClockRatio(void) {
 
 void GPU_Destroy(void)
 {
+#ifdef GPU_TRACE
+   gpu_trace_deinit();
+#endif
+
    delete [] GPU.vram;
 }
 
@@ -717,6 +771,8 @@ void GPU_Rescale(uint8 ushift)
    if (vram_new)
       delete [] vram_new;
    vram_new = NULL;
+
+   GPU_InvalidateScanout();
 }
 
 void GPU_FillVideoParams(MDFNGI* gi)
@@ -924,8 +980,14 @@ void GPU_Power(void)
 
    GPU.lastts = 0;
 
+   GPU_InvalidateScanout();
+
    GPU_SoftReset();
 
+#ifdef GPU_TRACE
+   gpu_trace_power();
+#endif
+
    IRQ_Assert(IRQ_VBLANK, GPU.InVBlank);
    TIMER_SetVBlank(GPU.InVBlank);
 }
@@ -936,6 +998,11 @@ void GPU_ResetTS(void)
 }
 
 
+#ifdef GPU_TRACE
+static uint64 trace_commands;
+static uint64 trace_primitives;
+#endif
+
 static void ProcessFIFO(uint32_t in_count)
 {
    uint32_t CB[0x10], InData;
@@ -955,7 +1022,13 @@ static void ProcessFIFO(uint32_t in_count)
 
          for(i = 0; i < 2; i++)
          {
-            bool fetch = texel_fetch(&GPU, GPU.FBRW_CurX & 1023, GPU.FBRW_CurY & 511) & GPU.MaskEvalAND;
+            bool fetch;
+
+            /* Rows only count as written once their data arrives */
+            if(GPU.FBRW_CurX == GPU.FBRW_X)
+               MarkDirty(&GPU, GPU.FBRW_X, GPU.FBRW_CurY, GPU.FBRW_W, 1);
+
+            fetch = texel_fetch(&GPU, GPU.FBRW_CurX & 1023, GPU.FBRW_CurY & 511) & GPU.MaskEvalAND;
 
             if (!fetch)
                texel_put(GPU.FBRW_CurX & 1023, GPU.FBRW_CurY & 511, InData | GPU.MaskSetOR);
@@ -1039,6 +1112,12 @@ static void ProcessFIFO(uint32_t in_count)
          SetTPage(&GPU, CB[4 + ((cc >> 4) & 0x1)] >> 16);
    }
 
+#ifdef GPU_TRACE
+   trace_commands++;
+   if (cc >= 0x20 && cc <= 0x7F)
+      trace_primitives++;
+#endif
+
    if ((cc >= 0x80) && (cc <= 0x9F))
       Command_FBCopy(&GPU, CB);
    else if ((cc >= 0xA0) && (cc <= 0xBF))
@@ -1062,6 +1141,10 @@ static INLINE void GPU_WriteCB(uint32_t InData, uint32_t addr)
       return;
    }
 
+#ifdef GPU_TRACE
+   gpu_trace_gp0(GPU.lastts, addr, InData);
+#endif
+
    PGXP_WriteFIFO(ReadMem(addr), GPU_BlitterFIFO.write_pos);
    GPU_BlitterFIFO.Write(InData);
 
@@ -1069,14 +1152,23 @@ static INLINE void GPU_WriteCB(uint32_t InData, uint32_t addr)
       ProcessFIFO(GPU_BlitterFIFO.in_count);
 }
 
+/* The caller synced the GPU to 'timestamp' before the write, so this
+ * only recomputes the next event once the line timing or the FIFO has
+ * changed under an idle GPU's event schedule. */
 void GPU_Write(const int32_t timestamp, uint32_t A, uint32_t V)
 {
+   bool resched = false;
+
    V <<= (A & 3) * 8;
 
    if(A & 4)   // GP1 ("Control")
    {
       uint32_t command = V >> 24;
 
+#ifdef GPU_TRACE
+      gpu_trace_gp1(timestamp, V);
+#endif
+
       V &= 0x00FFFFFF;
 
       //PSX_WARNING("[GPU] Control command: %02x %06x %d", command, V, scanline);
@@ -1095,6 +1187,7 @@ void GPU_Write(const int32_t timestamp, uint32_t A, uint32_t V)
              rsx_intf_set_draw_area(GPU.ClipX0, GPU.ClipY0,
                                     GPU.ClipX1, GPU.ClipY1);
              UpdateDisplayMode();
+            resched = true;
             break;
 
          case 0x01:  // Reset command buffer
@@ -1132,12 +1225,14 @@ void GPU_Write(const int32_t timestamp, uint32_t A, uint32_t V)
          case 0x07:
             GPU.VertStart = V & 0x3FF;
             GPU.VertEnd = (V >> 10) & 0x3FF;
+            resched = true;
             break;
 
          case 0x08:
             //printf("\n\nDISPLAYMODE SET: 0x%02x, %u *************************\n\n\n", V & 0xFF, scanline);
             GPU.DisplayMode = V & 0xFF;
             UpdateDisplayMode();
+            resched = true;
             break;
 
          case 0x09:
@@ -1192,19 +1287,38 @@ void GPU_Write(const int32_t timestamp, uint32_t A, uint32_t V)
       //uint32_t command = V >> 24;
       //printf("Meow command: %02x\n", command);
       //assert(!(GPU.DMAControl & 2));
+      const bool was_empty = !GPU_BlitterFIFO.in_count;
+
       GPU_WriteCB(V, A);
+
+      resched = was_empty && GPU_BlitterFIFO.in_count;
    }
+
+   if(resched)
+      PSX_SetEventNT(PSX_EVENT_GPU, GPU_Update(timestamp));
 }
 
 void GPU_WriteDMA(uint32_t V, uint32 addr)
 {
+   const bool was_empty = !GPU_BlitterFIFO.in_count;
+
    GPU_WriteCB(V, addr);
+
+   /* DMA_Update() synced the GPU before running the channel. If a
+    * command is now waiting for drawing time, the GPU has to leave
+    * its idle event schedule. */
+   if(was_empty && GPU_BlitterFIFO.in_count)
+      PSX_SetEventNT(PSX_EVENT_GPU, GPU_Update(GPU.lastts));
 }
 
 static INLINE uint32_t GPU_ReadData(void)
 {
    unsigned i;
 
+#ifdef GPU_TRACE
+   gpu_trace_read(GPU.lastts);
+#endif
+
    GPU.DataReadBufferEx = 0;
 
    for(i = 0; i < 2; i++)
@@ -1307,48 +1421,504 @@ uint32_t GPU_Read(const int32_t timestamp, uint32_t A)
    return(ret >> ((A & 3) * 8));
 }
 
-static INLINE void ReorderRGB_Var(uint32_t out_Rshift,
-      uint32_t out_Gshift, uint32_t out_Bshift,
-      bool bpp24, const uint16_t *src, uint32_t *dest,
-      const int32 dx_start, const int32 dx_end, int32 fb_x,
-      unsigned upscale_shift, unsigned upscale)
+#if defined(WANT_16BPP)
+/* Convert a 15bpp VRAM pixel to the RGB565 output surface format. The
+ * top bit of green is replicated into the extra low bit. */
+#define RGB15_TO_SURFACE(p) \
+   ((((p) & 0x001F) << 11) | \
+    (((p) & 0x03E0) << 1) | \
+    (((p) >> 4) & 0x0020) | \
+    (((p) >> 10) & 0x001F))
+
+/* Convert a 24bpp VRAM pixel (R in the low byte) to the RGB565
+ * output surface format */
+#define RGB24_TO_SURFACE(p) \
+   ((((p) & 0xF8) << 8) | \
+    (((p) >> 5) & 0x07E0) | \
+    (((p) >> 19) & 0x001F))
+
+/* Convert 'count' contiguous 15bpp pixels */
+static INLINE void Scanout_RGB15(uint16_t *dest, const uint16_t *src, uint32_t count)
 {
-  int32_t fb_mask = ((0x7FF << upscale_shift) + upscale - 1);
+   uint32_t x = 0;
 
-   if(bpp24)   // 24bpp
+#if defined(__SSE2__)
+   for(; (x + 8) <= count; x += 8)
+   {
+      __m128i p = _mm_loadu_si128((const __m128i *)&src[x]);
+      __m128i r = _mm_slli_epi16(p, 11);
+      __m128i g = _mm_or_si128(
+            _mm_slli_epi16(_mm_and_si128(p, _mm_set1_epi16(0x03E0)), 1),
+            _mm_and_si128(_mm_srli_epi16(p, 4), _mm_set1_epi16(0x0020)));
+      __m128i b = _mm_and_si128(_mm_srli_epi16(p, 10), _mm_set1_epi16(0x001F));
+
+      _mm_storeu_si128((__m128i *)&dest[x], _mm_or_si128(_mm_or_si128(r, g), b));
+   }
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+   for(; (x + 8) <= count; x += 8)
+   {
+      uint16x8_t p = vld1q_u16(&src[x]);
+      uint16x8_t r = vshlq_n_u16(p, 11);
+      uint16x8_t g = vorrq_u16(
+            vshlq_n_u16(vandq_u16(p, vdupq_n_u16(0x03E0)), 1),
+            vandq_u16(vshrq_n_u16(p, 4), vdupq_n_u16(0x0020)));
+      uint16x8_t b = vandq_u16(vshrq_n_u16(p, 10), vdupq_n_u16(0x001F));
+
+      vst1q_u16(&dest[x], vorrq_u16(vorrq_u16(r, g), b));
+   }
+#endif
+
+   for(; x < count; x++)
+      dest[x] = RGB15_TO_SURFACE(src[x]);
+}
+
+/* Convert 'count' 24bpp pixels starting at byte offset 'byte_offset'
+ * (0 or 1) of a contiguous native resolution line. The line must
+ * have at least 16 readable bytes past the last pixel. */
+static INLINE void Scanout_RGB24(uint16_t *dest, const uint16_t *line,
+      uint32_t byte_offset, uint32_t count)
+{
+   uint32_t x = 0;
+
+#if defined(__SSE2__)
+   const uint8_t *bytes = (const uint8_t *)line + byte_offset;
+
+   for(; (x + 4) <= count; x += 4)
+   {
+      __m128i p  = _mm_loadu_si128((const __m128i *)&bytes[x * 3]);
+      __m128i ab = _mm_unpacklo_epi32(p, _mm_srli_si128(p, 3));
+      __m128i cd = _mm_unpacklo_epi32(_mm_srli_si128(p, 6), _mm_srli_si128(p, 9));
+      __m128i v  = _mm_unpacklo_epi64(ab, cd);
+      __m128i r  = _mm_slli_epi32(_mm_and_si128(v, _mm_set1_epi32(0xF8)), 8);
+      __m128i g  = _mm_and_si128(_mm_srli_epi32(v, 5), _mm_set1_epi32(0x07E0));
+      __m128i b  = _mm_and_si128(_mm_srli_epi32(v, 19), _mm_set1_epi32(0x001F));
+
+      /* Sign extend the 16-bit results so the saturating pack
+       * keeps them intact */
+      v = _mm_or_si128(_mm_or_si128(r, g), b);
+      v = _mm_srai_epi32(_mm_slli_epi32(v, 16), 16);
+      _mm_storel_epi64((__m128i *)&dest[x], _mm_packs_epi32(v, v));
+   }
+#endif
+
+   for(; x < count; x++)
+   {
+      const uint32_t b      = byte_offset + x * 3;
+      const uint32_t srcpix = (line[b >> 1] | (line[(b >> 1) + 1] << 16)) >> ((b & 1) * 8);
+
+      dest[x] = RGB24_TO_SURFACE(srcpix);
+   }
+}
+
+/* Duplicate each of the 'count' pixels of 'src' 'upscale' times */
+static INLINE void Scanout_Replicate(uint16_t *dest, const uint16_t *src,
+      uint32_t count, unsigned upscale)
+{
+   uint32_t x;
+
+#if defined(__SSE2__)
+   if(upscale == 2)
+   {
+      for(x = 0; (x + 8) <= count; x += 8)
+      {
+         __m128i p = _mm_loadu_si128((const __m128i *)&src[x]);
+
+         _mm_storeu_si128((__m128i *)&dest[x * 2 + 0], _mm_unpacklo_epi16(p, p));
+         _mm_storeu_si128((__m128i *)&dest[x * 2 + 8], _mm_unpackhi_epi16(p, p));
+      }
+
+      for(; x < count; x++)
+         dest[x * 2 + 0] = dest[x * 2 + 1] = src[x];
+      return;
+   }
+
+   if(upscale == 4)
+   {
+      for(x = 0; x < count; x++)
+         _mm_storel_epi64((__m128i *)&dest[x * 4], _mm_set1_epi16(src[x]));
+      return;
+   }
+
+   if(upscale >= 8)
+   {
+      for(x = 0; x < count; x++)
+      {
+         const __m128i p = _mm_set1_epi16(src[x]);
+         unsigned i;
+
+         for(i = 0; i < upscale; i += 8)
+            _mm_storeu_si128((__m128i *)&dest[x * upscale + i], p);
+      }
+      return;
+   }
+#endif
+
+   for(x = 0; x < count; x++)
+   {
+      unsigned i;
+
+      for(i = 0; i < upscale; i++)
+         dest[x * upscale + i] = src[x];
+   }
+}
+#else
+/* Convert a 15bpp VRAM pixel to the XRGB8888 output surface format */
+#define RGB15_TO_SURFACE(p) \
+   ((((p) & 0x001F) << (RED_SHIFT + 3)) | \
+    (((p) & 0x03E0) << (GREEN_SHIFT - 2)) | \
+    (((p) & 0x7C00) >> (7 - BLUE_SHIFT)))
+
+/* Convert a 24bpp VRAM pixel (R in the low byte) to the XRGB8888
+ * output surface format */
+#define RGB24_TO_SURFACE(p) \
+   (((((p) >>  0) & 0xFF) << RED_SHIFT) | \
+    ((((p) >>  8) & 0xFF) << GREEN_SHIFT) | \
+    ((((p) >> 16) & 0xFF) << BLUE_SHIFT))
+
+#if defined(__SSE2__)
+static INLINE __m128i RGB15_To_Surface_SSE2(__m128i p)
+{
+   __m128i r = _mm_slli_epi32(_mm_and_si128(p, _mm_set1_epi32(0x001F)), RED_SHIFT + 3);
+   __m128i g = _mm_slli_epi32(_mm_and_si128(p, _mm_set1_epi32(0x03E0)), GREEN_SHIFT - 2);
+   __m128i b = _mm_srli_epi32(_mm_and_si128(p, _mm_set1_epi32(0x7C00)), 7 - BLUE_SHIFT);
+
+   return _mm_or_si128(_mm_or_si128(r, g), b);
+}
+#endif
+
+/* Convert 'count' contiguous 15bpp pixels */
+static INLINE void Scanout_RGB15(uint32_t *dest, const uint16_t *src, uint32_t count)
+{
+   uint32_t x = 0;
+
+#if defined(__SSE2__)
+   const __m128i zero = _mm_setzero_si128();
+
+   for(; (x + 8) <= count; x += 8)
    {
-      for(int32 x = dx_start; x < dx_end; x+= upscale)
+      __m128i p = _mm_loadu_si128((const __m128i *)&src[x]);
+
+      _mm_storeu_si128((__m128i *)&dest[x + 0], RGB15_To_Surface_SSE2(_mm_unpacklo_epi16(p, zero)));
+      _mm_storeu_si128((__m128i *)&dest[x + 4], RGB15_To_Surface_SSE2(_mm_unpackhi_epi16(p, zero)));
+   }
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+   for(; (x + 8) <= count; x += 8)
+   {
+      uint16x8_t p  = vld1q_u16(&src[x]);
+      uint32x4_t lo = vmovl_u16(vget_low_u16(p));
+      uint32x4_t hi = vmovl_u16(vget_high_u16(p));
+
+      lo = vorrq_u32(vorrq_u32(
+               vshlq_n_u32(vandq_u32(lo, vdupq_n_u32(0x001F)), RED_SHIFT + 3),
+               vshlq_n_u32(vandq_u32(lo, vdupq_n_u32(0x03E0)), GREEN_SHIFT - 2)),
+               vshrq_n_u32(vandq_u32(lo, vdupq_n_u32(0x7C00)), 7 - BLUE_SHIFT));
+      hi = vorrq_u32(vorrq_u32(
+               vshlq_n_u32(vandq_u32(hi, vdupq_n_u32(0x001F)), RED_SHIFT + 3),
+               vshlq_n_u32(vandq_u32(hi, vdupq_n_u32(0x03E0)), GREEN_SHIFT - 2)),
+               vshrq_n_u32(vandq_u32(hi, vdupq_n_u32(0x7C00)), 7 - BLUE_SHIFT));
+
+      vst1q_u32(&dest[x + 0], lo);
+      vst1q_u32(&dest[x + 4], hi);
+   }
+#endif
+
+   for(; x < count; x++)
+      dest[x] = RGB15_TO_SURFACE(src[x]);
+}
+
+/* Convert 'count' 24bpp pixels starting at byte offset 'byte_offset'
+ * (0 or 1) of a contiguous native resolution line. The line must
+ * have at least 16 readable bytes past the last pixel. */
+static INLINE void Scanout_RGB24(uint32_t *dest, const uint16_t *line,
+      uint32_t byte_offset, uint32_t count)
+{
+   uint32_t x = 0;
+
+#if defined(__SSE2__)
+   /* SSE2 targets are little endian: the VRAM line can be read
+    * as a plain byte stream, 4 pixels (12 bytes) at a time. */
+   const uint8_t *bytes = (const uint8_t *)line + byte_offset;
+   const __m128i mask   = _mm_set1_epi32(0xFF);
+
+   for(; (x + 4) <= count; x += 4)
+   {
+      __m128i p  = _mm_loadu_si128((const __m128i *)&bytes[x * 3]);
+      __m128i ab = _mm_unpacklo_epi32(p, _mm_srli_si128(p, 3));
+      __m128i cd = _mm_unpacklo_epi32(_mm_srli_si128(p, 6), _mm_srli_si128(p, 9));
+      __m128i v  = _mm_unpacklo_epi64(ab, cd);
+      __m128i r  = _mm_slli_epi32(_mm_and_si128(v, mask), RED_SHIFT);
+      __m128i g  = _mm_slli_epi32(_mm_and_si128(_mm_srli_epi32(v, 8), mask), GREEN_SHIFT);
+      __m128i b  = _mm_slli_epi32(_mm_and_si128(_mm_srli_epi32(v, 16), mask), BLUE_SHIFT);
+
+      _mm_storeu_si128((__m128i *)&dest[x], _mm_or_si128(_mm_or_si128(r, g), b));
+   }
+#endif
+
+   for(; x < count; x++)
+   {
+      const uint32_t b      = byte_offset + x * 3;
+      const uint32_t srcpix = (line[b >> 1] | (line[(b >> 1) + 1] << 16)) >> ((b & 1) * 8);
+
+      dest[x] = RGB24_TO_SURFACE(srcpix);
+   }
+}
+
+/* Duplicate each of the 'count' pixels of 'src' 'upscale' times */
+static INLINE void Scanout_Replicate(uint32_t *dest, const uint32_t *src,
+      uint32_t count, unsigned upscale)
+{
+   uint32_t x;
+
+#if defined(__SSE2__)
+   if(upscale == 2)
+   {
+      for(x = 0; (x + 4) <= count; x += 4)
       {
-         int i;
-         uint32_t color;
-         uint32_t srcpix = src[(fb_x >> 1) + 0]
-            | (src[((fb_x >> 1) + (1 << upscale_shift)) & fb_mask] << 16);
-         srcpix >>= ((fb_x >> upscale_shift) & 1) * 8;
+         __m128i p = _mm_loadu_si128((const __m128i *)&src[x]);
+
+         _mm_storeu_si128((__m128i *)&dest[x * 2 + 0], _mm_unpacklo_epi32(p, p));
+         _mm_storeu_si128((__m128i *)&dest[x * 2 + 4], _mm_unpackhi_epi32(p, p));
+      }
 
-         color =   (((srcpix >> 0) << RED_SHIFT)   & (0xFF << RED_SHIFT))
-            | (((srcpix >> 8) << GREEN_SHIFT) & (0xFF << GREEN_SHIFT))
-            | (((srcpix >> 16) << BLUE_SHIFT) & (0xFF << BLUE_SHIFT));
+      for(; x < count; x++)
+         dest[x * 2 + 0] = dest[x * 2 + 1] = src[x];
+      return;
+   }
 
-         for (i = 0; i < upscale; i++)
-            dest[x + i] = color;
+   if(upscale >= 4)
+   {
+      for(x = 0; x < count; x++)
+      {
+         const __m128i p = _mm_set1_epi32(src[x]);
+         unsigned i;
 
-         fb_x = (fb_x + (3 << upscale_shift)) & fb_mask;
+         for(i = 0; i < upscale; i += 4)
+            _mm_storeu_si128((__m128i *)&dest[x * upscale + i], p);
+      }
+      return;
+   }
+#endif
+
+   for(x = 0; x < count; x++)
+   {
+      unsigned i;
+
+      for(i = 0; i < upscale; i++)
+         dest[x * upscale + i] = src[x];
+   }
+}
+#endif
+
+/* Convert one (upscaled) VRAM line to the output surface.
+ *
+ * 'src_y' is the upscaled VRAM row, 'fb_x' is the upscaled framebuffer
+ * X position in half-pixels (bytes in 24bpp mode) and
+ * [dx_start, dx_end) is the upscaled output range. */
+static INLINE void ReorderRGB_Var(bool bpp24, uint32_t src_y,
+      MDFN_SurfacePixel *dest, const int32 dx_start, const int32 dx_end, int32 fb_x,
+      unsigned upscale_shift, unsigned upscale)
+{
+   const uint32_t row_len = 1024 << upscale_shift;
+
+   if(dx_end <= dx_start)
+      return;
+
+   if(bpp24)   // 24bpp
+   {
+      /* 24bpp is only ever displayed at native horizontal
+       * resolution: gather the native pixels of the line (the
+       * first sub-pixel of each upscaled texel) in a contiguous
+       * buffer, convert them and then replicate horizontally. */
+      static uint16_t line[1024 + 64];
+      static MDFN_SurfacePixel pixels[1024];
+      const uint32_t count     = (dx_end - dx_start) >> upscale_shift;
+      const uint32_t fb_byte   = (fb_x >> upscale_shift) & 0x7FF;
+      const uint32_t word      = fb_byte >> 1;
+      const uint32_t nwords    = ((fb_byte & 1) + count * 3 + 1) / 2 + 8;
+      const uint16_t *line_ptr = line;
+      uint32_t i;
+
+      if(upscale_shift == 0 && (word + nwords) <= row_len)
+         line_ptr = vram_ptr(&GPU, word, src_y);
+      else
+      {
+         for(i = 0; i < nwords; i++)
+            line[i] = vram_fetch(&GPU, ((word + i) & 1023) << upscale_shift, src_y);
+      }
+
+      if(upscale == 1)
+         Scanout_RGB24(dest + dx_start, line_ptr, fb_byte & 1, count);
+      else
+      {
+         Scanout_RGB24(pixels, line_ptr, fb_byte & 1, count);
+         Scanout_Replicate(dest + dx_start, pixels, count, upscale);
       }
    }           // 15bpp
    else
    {
-      for(int32 x = dx_start; x < dx_end; x++)
+      uint32_t count = dx_end - dx_start;
+      uint32_t x     = (fb_x >> 1) & (row_len - 1);
+
+      dest += dx_start;
+
+      while(count)
+      {
+         const uint32_t n = std::min<uint32_t>(count, vram_run(&GPU, x));
+
+         Scanout_RGB15(dest, vram_ptr(&GPU, x, src_y), n);
+         dest  += n;
+         count -= n;
+         x      = (x + n) & (row_len - 1);
+      }
+   }
+}
+
+/* Check whether output line 'dest_line' already holds the result of
+ * the conversion about to be done (same parameters as in the previous
+ * frame and no VRAM write to its source since then), and record the
+ * parameters of this conversion. */
+static bool Scanout_LineUnchanged(int32 dest_line, int32 fb_x,
+      int32 dx_start, int32 dx_end, uint32 dmw)
+{
+   scanout_line *line;
+   uint32_t mode, cols, c0, c1, words;
+   bool unchanged;
+
+   if((uint32)dest_line >= SCANOUT_MAX_LINES)
+      return false;
+
+   line = &GPU.ScanoutLines[dest_line];
+   mode = (GPU.DisplayMode & DISP_RGB24) | (dmw << 8) | (GPU.upscale_shift << 24);
+
+   /* The left border must cover the two pixels cleared at the start
+    * of every frame, unless the whole line is black. */
+   unchanged = GPU.ScanoutSkip
+      && !GPU.espec->InterlaceOn
+      && (dx_start >= 2 || dx_end <= dx_start)
+      && line->frame == (GPU.ScanoutFrame - 1)
+      && line->src_y == GPU.DisplayFB_CurLineYReadout
+      && line->fb_x == fb_x
+      && line->dx_start == dx_start
+      && line->dx_end == dx_end
+      && line->mode == mode;
+
+   if(unchanged && dx_end > dx_start)
+   {
+      /* Native VRAM pixels read by the line */
+      if(GPU.DisplayMode & DISP_RGB24)
+         words = ((dx_end - dx_start) * 3 + 1) / 2 + 1;
+      else
+         words = dx_end - dx_start;
+
+      if(words >= 1024)
+         cols = 0xFFFF;
+      else
       {
-         uint32_t srcpix = src[(fb_x >> 1)];
-         dest[x] = MAKECOLOR(
-               (((srcpix >> 0) & 0x1F) << 3),
-               (((srcpix >> 5) & 0x1F) << 3),
-               (((srcpix >> 10) & 0x1F) << 3),
-               0);
-
-         fb_x = (fb_x + 2) & fb_mask;
+         c0 = ((fb_x >> 1) & 1023) >> 6;
+         c1 = (((fb_x >> 1) + words - 1) & 1023) >> 6;
+
+         if(c0 <= c1)
+            cols = ((2U << c1) - 1) & ~((1U << c0) - 1);
+         else
+            cols = ((2U << c1) - 1) | (0xFFFF & ~((1U << c0) - 1));
       }
+
+      if((GPU.DirtyCur[GPU.DisplayFB_CurLineYReadout >> 4]
+               | GPU.DirtyPrev[GPU.DisplayFB_CurLineYReadout >> 4]) & cols)
+         unchanged = false;
    }
+
+   /* Lines converted while interlaced may be overwritten by the
+    * other field when bobbing, never consider them up to date. */
+   line->frame    = GPU.espec->InterlaceOn ? 0 : GPU.ScanoutFrame;
+   line->src_y    = GPU.DisplayFB_CurLineYReadout;
+   line->fb_x     = fb_x;
+   line->dx_start = dx_start;
+   line->dx_end   = dx_end;
+   line->mode     = mode;
+
+   if(!unchanged)
+      GPU.ScanoutChanged = true;
+
+   return unchanged;
+}
+
+/* The output surface is sized for the display modes actually seen and
+ * grown whenever a wider or taller one shows up. Takes native sizes. */
+static bool ReserveSurface(uint32 w, uint32 h)
+{
+   w <<= GPU.upscale_shift;
+   h <<= GPU.upscale_shift;
+
+   if((int32)w <= GPU.surface->w && (int32)h <= GPU.surface->h)
+      return true;
+
+   if(!GPU.surface->Grow(w, h))
+   {
+      PSX_WARNING("[GPU] Couldn't grow the output surface to %ux%u.", w, h);
+      return false;
+   }
+
+   return true;
+}
+
+/* Number of lines from 'line' until 'target' is entered next, 1 to
+ * LinesPerField; targets past the end of the field never are. */
+static INLINE uint32 LinesUntil(uint32 line, uint32 target, uint32 dist)
+{
+   if(target < (uint32)GPU.LinesPerField)
+   {
+      const uint32 d = (target + GPU.LinesPerField - line - 1) % GPU.LinesPerField + 1;
+
+      if(d < dist)
+         return d;
+   }
+
+   return dist;
+}
+
+/* GPU clocks until the next line that has to be processed on time is
+ * entered: frame setup, field change, VBlank edges and the main loop
+ * exit checks.  Line lengths follow GPU_Update(); NTSC lines alternate
+ * between 3412 and 3413 clocks according to PhaseChange. */
+static int32 ClocksToEventLine(void)
+{
+   const uint32 line = GPU.scanline;
+   uint32 lines      = GPU.LinesPerField;
+   int32 clocks      = GPU.LineClockCounter + (GPU.LinePhase ? 0 : 200);
+
+   lines = LinesUntil(line, 0, lines);
+   lines = LinesUntil(line, GPU.LinesPerField - 1, lines);
+   lines = LinesUntil(line, GPU.VertStart, lines);
+   lines = LinesUntil(line, GPU.VertEnd, lines);
+   lines = LinesUntil(line, GPU.HardwarePALType ? 308 : 256, lines);
+
+   /* Whole lines between the one being entered next and the event line */
+   lines--;
+
+   if(GPU.DisplayMode & DISP_PAL)
+      clocks += lines * 3405;
+   else
+      clocks += lines * 3412 + ((lines + GPU.PhaseChange) >> 1);
+
+   return clocks;
+}
+
+/* Runs of scanlines are processed in a single event unless something
+ * outside of the GPU depends on the timing of every line: commands
+ * waiting for drawing time, counters clocked by the GPU or light guns
+ * sampling the output. */
+static INLINE bool CanBatchLines(void)
+{
+   return !GPU_BlitterFIFO.in_count
+      && !TIMER_FollowsGPULines()
+      && !PSX_GPULineHookTimed();
+}
+
+void GPU_Sync(const int32_t timestamp)
+{
+   PSX_SetEventNT(PSX_EVENT_GPU,
+         GPU_Update(std::max<int32_t>(timestamp, GPU.lastts)));
 }
 
 int32_t GPU_Update(const int32_t sys_timestamp)
@@ -1493,15 +2063,21 @@ int32_t GPU_Update(const int32_t sys_timestamp)
                      GPU.DisplayRect->w = 384;
                      GPU.DisplayRect->h = VisibleLineCount;
 
+                     if(!ReserveSurface(384, VisibleLineCount))
+                        GPU.DisplayRect->h = 0;
+
                      for(int32 y = 0; y < GPU.DisplayRect->h; y++)
                      {
-                        uint32_t *dest = GPU.surface->pixels + y * GPU.surface->pitch32;
+                        MDFN_SurfacePixel *dest = (MDFN_SurfacePixel *)GPU.surface->pixels
+                           + y * GPU.surface->pitchinpix;
 
                         GPU.LineWidths[y] = 384;
 
-                        memset(dest, 0, 384 * sizeof(int32));
+                        memset(dest, 0, 384 * sizeof(MDFN_SurfacePixel));
                      }
 
+                     GPU_InvalidateScanout();
+
                      //char buffer[256];
                      //snprintf(buffer, sizeof(buffer), _("VIDEO STANDARD MISMATCH"));
                      //DrawTextTrans(surface->pixels + ((DisplayRect->h / 2) - (13 / 2)) * surface->pitch32, surface->pitch32 << 2, DisplayRect->w, (UTF8*)buffer,
@@ -1520,10 +2096,40 @@ int32_t GPU_Update(const int32_t sys_timestamp)
                      // Clear ~0 state.
                      GPU.LineWidths[0] = 0;
 
+                     if(!ReserveSurface(dmw, GPU.DisplayRect->h))
+                        GPU.DisplayRect->h = 0;
+
+                     GPU.DeintBob = false;
+
+#ifdef NEED_DEINTERLACER
+                     if(GPU.espec->InterlaceOn)
+                     {
+                        /* Weave only if the rows of the other field
+                         * hold a field of the same geometry. */
+                        const uint32 prev_field = 1 | (GPU.espec->InterlaceField << 1)
+                           | (dmw << 2) | (GPU.DisplayRect->h << 12)
+                           | (GPU.upscale_shift << 24);
+
+                        GPU.DeintBob       = GPU.DeintPrevField != (prev_field ^ 2);
+                        GPU.DeintPrevField = prev_field;
+                     }
+                     else
+                        GPU.DeintPrevField = 0;
+#endif
+
                      for(int i = 0; i < (GPU.DisplayRect->y + GPU.DisplayRect->h); i++)
                      {
-                        GPU.surface->pixels[i * GPU.surface->pitch32 + 0] =
-                           GPU.surface->pixels[i * GPU.surface->pitch32 + 1] = 0;
+                        MDFN_SurfacePixel *dest = (MDFN_SurfacePixel *)GPU.surface->pixels
+                           + i * GPU.surface->pitchinpix;
+
+#ifdef NEED_DEINTERLACER
+                        /* Weave: keep the previous field */
+                        if(GPU.espec->InterlaceOn && !GPU.DeintBob
+                              && (i & 1) != GPU.espec->InterlaceField)
+                           continue;
+#endif
+
+                        dest[0] = dest[1] = 0;
                         GPU.LineWidths[i] = 2;
                      }
                   }
@@ -1600,7 +2206,8 @@ int32_t GPU_Update(const int32_t sys_timestamp)
             unsigned pix_clock_offset = 0;
             unsigned pix_clock = 0;
             unsigned pix_clock_div = 0;
-            uint32_t *dest = NULL;
+            MDFN_SurfacePixel *dest = NULL;
+            int32 dest_line         = 0;
 
             if((bool)(GPU.DisplayMode & DISP_PAL) == GPU.HardwarePALType
                   && GPU.scanline >= FirstVisibleLine
@@ -1608,7 +2215,7 @@ int32_t GPU_Update(const int32_t sys_timestamp)
             {
                int32 fb_x      = GPU.DisplayFB_XStart * 2;
                int32 dx_start  = GPU.HorizStart, dx_end = GPU.HorizEnd;
-               int32 dest_line =
+               dest_line =
                   ((GPU.scanline - FirstVisibleLine) << GPU.espec->InterlaceOn)
                   + GPU.espec->InterlaceField;
 
@@ -1638,37 +2245,39 @@ int32_t GPU_Update(const int32_t sys_timestamp)
 
                //printf("dx_start base: %d, dmw: %d\n", dx_start, dmw);
 
-               if (rsx_intf_is_type() == RSX_SOFTWARE)
+               /* The display mode may have changed since scanline 0 */
+               if (rsx_intf_is_type() == RSX_SOFTWARE
+                     && ReserveSurface(dmw, VisibleLineCount << GPU.espec->InterlaceOn))
                {
                   // Convert the necessary variables to the upscaled version
-                  uint32_t x;
                   uint32_t y        = GPU.DisplayFB_CurLineYReadout << GPU.upscale_shift;
                   uint32_t udmw     = dmw      << GPU.upscale_shift;
                   int32 udx_start   = dx_start << GPU.upscale_shift;
                   int32 udx_end     = dx_end   << GPU.upscale_shift;
                   int32 ufb_x       = fb_x     << GPU.upscale_shift;
                   unsigned _upscale = UPSCALE(&GPU);
+                  bool unchanged    = Scanout_LineUnchanged(dest_line,
+                        fb_x, dx_start, dx_end, dmw);
 
                   for (uint32_t i = 0; i < _upscale; i++)
                   {
-                     const uint16_t *src = GPU.vram +
-                        ((y + i) << (10 + GPU.upscale_shift));
 
                      // printf("surface: %dx%d (%d) %u %u + %u\n",
                      //       surface->w, surface->h, surface->pitchinpix,
                      //       dest_line, y, i);
 
-                     dest = GPU.surface->pixels +
-                        ((dest_line << GPU.upscale_shift) + i) * GPU.surface->pitch32;
-                     memset(dest, 0, udx_start * sizeof(int32));
+                     dest = (MDFN_SurfacePixel *)GPU.surface->pixels +
+                        ((dest_line << GPU.upscale_shift) + i) * GPU.surface->pitchinpix;
+
+                     if (unchanged)
+                        continue;
+
+                     memset(dest, 0, udx_start * sizeof(MDFN_SurfacePixel));
 
                      //printf("%d %d %d - %d %d\n", scanline, dx_start, dx_end, HorizStart, HorizEnd);
                      ReorderRGB_Var(
-                           RED_SHIFT,
-                           GREEN_SHIFT,
-                           BLUE_SHIFT,
                            GPU.DisplayMode & DISP_RGB24,
-                           src,
+                           y + i,
                            dest,
                            udx_start,
                            udx_end,
@@ -1678,8 +2287,8 @@ int32_t GPU_Update(const int32_t sys_timestamp)
 
                      //printf("dx_end: %d, dmw: %d\n", udx_end, udmw);
                      //
-                     for(x = udx_end; x < udmw; x++)
-                        dest[x] = 0;
+                     if((uint32_t)udx_end < udmw)
+                        memset(dest + udx_end, 0, (udmw - udx_end) * sizeof(MDFN_SurfacePixel));
                   }
                }
 
@@ -1701,6 +2310,25 @@ int32_t GPU_Update(const int32_t sys_timestamp)
                   pix_clock,
                   pix_clock_div);
 
+#ifdef NEED_DEINTERLACER
+            /* Bob: double the line (crosshairs included) into the
+             * rows of the other field */
+            if(dest && GPU.DeintBob)
+            {
+               const uint32 pitch   = GPU.surface->pitchinpix;
+               MDFN_SurfacePixel *src = (MDFN_SurfacePixel *)GPU.surface->pixels +
+                  (dest_line << GPU.upscale_shift) * pitch;
+               MDFN_SurfacePixel *dst = (MDFN_SurfacePixel *)GPU.surface->pixels +
+                  ((dest_line ^ 1) << GPU.upscale_shift) * pitch;
+
+               for (uint32_t i = 0; i < UPSCALE(&GPU); i++)
+                  memcpy(dst + i * pitch, src + i * pitch,
+                        (dmw << GPU.upscale_shift) * sizeof(MDFN_SurfacePixel));
+
+               GPU.LineWidths[dest_line ^ 1] = dmw;
+            }
+#endif
+
             if(!GPU.InVBlank)
                GPU.DisplayFB_CurYOffset = (GPU.DisplayFB_CurYOffset + 1) & 0x1FF;
          }
@@ -1718,12 +2346,14 @@ int32_t GPU_Update(const int32_t sys_timestamp)
 TheEnd:
    GPU.lastts = sys_timestamp;
 
-   int32 next_dt = GPU.LineClockCounter;
+   const bool batch = CanBatchLines();
+   int32 next_dt    = batch ? ClocksToEventLine() : GPU.LineClockCounter;
 
    next_dt = (((int64)next_dt << 16) - GPU.GPUClockCounter + GPU.GPUClockRatio - 1) / GPU.GPUClockRatio;
 
    next_dt = std::max<int32>(1, next_dt);
-   next_dt = std::min<int32>(128, next_dt);
+   if(!batch)
+      next_dt = std::min<int32>(128, next_dt);
 
    //printf("%d\n", next_dt);
 
@@ -1732,6 +2362,24 @@ TheEnd:
 
 void GPU_StartFrame(EmulateSpecStruct *espec_arg)
 {
+   unsigned i;
+
+   if(GPU.surface != espec_arg->surface)
+      GPU_InvalidateScanout();
+
+   for(i = 0; i < 32; i++)
+   {
+      GPU.DirtyPrev[i] = GPU.DirtyCur[i];
+      GPU.DirtyCur[i]  = 0;
+   }
+
+   GPU.ScanoutFrame++;
+   GPU.ScanoutChanged  = false;
+
+#ifdef GPU_TRACE
+   gpu_trace_frame();
+#endif
+
    GPU.sl_zero_reached = false;
    GPU.espec           = espec_arg;
    GPU.surface         = GPU.espec->surface;
@@ -1795,6 +2443,11 @@ void GPU_RestoreStateP2(bool load)
 
 void GPU_RestoreStateP3(void)
 {
+#ifdef GPU_TRACE
+   /* A trace can't represent a state load; keep what was recorded so far. */
+   gpu_trace_deinit();
+#endif
+
    for(unsigned i = 0; i < 256; i++)
    {
       GPU.TexCache[i].Tag = TexCache_Tag[i];
@@ -1837,6 +2490,7 @@ void GPU_RestoreStateP3(void)
                         GPU.vram, false, false);
 
    UpdateDisplayMode();
+   GPU_InvalidateScanout();
 }
 
 int GPU_StateAction(StateMem *sm, int load, int data_only)
@@ -1984,6 +2638,25 @@ unsigned GPU_get_display_change_count(void)
    return GPU.display_change_count;
 }
 
+void GPU_set_scanout_skip(bool enable)
+{
+   GPU.ScanoutSkip = enable;
+}
+
+bool GPU_get_scanout_changed(void)
+{
+   return GPU.ScanoutChanged;
+}
+
+/* Force the conversion of every output line and report the
+ * current frame as changed */
+void GPU_InvalidateScanout(void)
+{
+   GPU.ScanoutFrame  += 2;
+   GPU.ScanoutChanged = true;
+   GPU.DeintPrevField = 0;
+}
+
 void GPU_set_dither_upscale_shift(uint8 factor)
 {
    GPU.dither_upscale_shift = factor;
@@ -1997,6 +2670,9 @@ uint8 GPU_get_dither_upscale_shift(void)
 void GPU_set_upscale_shift(uint8 factor)
 {
    GPU.upscale_shift = factor;
+#ifdef HAVE_TILED_VRAM
+   GPU.vram_tile_shift = factor ? VRAM_TILE_H_SHIFT : 0;
+#endif
 }
 
 uint8 GPU_get_upscale_shift(void)
@@ -2021,9 +2697,60 @@ uint16 GPU_PeekRAM(uint32 A)
 
 void GPU_PokeRAM(uint32 A, uint16 V)
 {
+   MarkDirty(&GPU, A & 0x3FF, (A >> 10) & 0x1FF, 1, 1);
    texel_put(A & 0x3FF, (A >> 10) & 0x1FF, V);
 }
 
+#ifdef GPU_TRACE
+/* Trace replay runs without a CPU or any notion of time, so the FIFO is
+ * never allowed to stall on draw time. */
+void GPU_TraceReplayGP0(uint32 V, uint32 addr)
+{
+   GPU.DrawTimeAvail = 1 << 30;
+   GPU_WriteCB(V, addr);
+}
+
+/* Runs whatever piled up in the FIFO while a VRAM read was in progress. */
+void GPU_TraceReplayFlush(void)
+{
+   GPU.DrawTimeAvail = 1 << 30;
+
+   while (GPU_BlitterFIFO.in_count && GPU.InCmd != INCMD_FBREAD)
+   {
+      uint32 in_count = GPU_BlitterFIFO.in_count;
+      uint32 in_cmd   = GPU.InCmd;
+
+      ProcessFIFO(in_count);
+
+      if (GPU_BlitterFIFO.in_count == in_count && GPU.InCmd == in_cmd)
+         break;
+   }
+}
+
+void GPU_TraceCounters(uint64 *commands, uint64 *primitives)
+{
+   *commands   = trace_commands;
+   *primitives = trace_primitives;
+}
+
+/* MD5 of the (upscaled) VRAM in row order, whatever its memory layout */
+void GPU_TraceHashVRAM(uint8 digest[16])
+{
+   static uint16_t row[1024 << 4];
+   const uint32_t width = 1024 << GPU.upscale_shift;
+   struct md5_context md5;
+   uint32_t y;
+
+   mednafen_md5_starts(&md5);
+   for (y = 0; y < (512U << GPU.upscale_shift); y++)
+   {
+      vram_read_row(&GPU, 0, y, row, width);
+      mednafen_md5_update(&md5, (uint8_t*)row, width * sizeof(uint16_t));
+   }
+   mednafen_md5_finish(&md5, digest);
+}
+#endif
+
 /* Set a pixel in VRAM, upscaling it if necessary */
 void texel_put(uint32 x, uint32 y, uint16 v)
 {
@@ -46,6 +46,21 @@ struct tri_vertex
 struct i_group;
 struct i_deltas;
 
+/* Maximum number of output lines (interlaced PAL) */
+#define SCANOUT_MAX_LINES 576
+
+/* Parameters used for the last conversion of an output line, to
+ * detect lines that would be converted to the exact same pixels */
+struct scanout_line
+{
+   uint32 frame;
+   uint32 src_y;
+   int32 fb_x;
+   int32 dx_start;
+   int32 dx_end;
+   uint32 mode;
+};
+
 struct line_point
 {
    int32 x, y;
@@ -85,6 +100,9 @@ struct PS_GPU
 
    /* Beetle-psx upscaling vars */
    uint8 upscale_shift;
+#ifdef HAVE_TILED_VRAM
+   uint8 vram_tile_shift;
+#endif
    uint8 dither_upscale_shift;
 
    // Drawing stuff
@@ -219,6 +237,25 @@ struct PS_GPU
 
    uint8_t DitherLUT[4][4][512]; // Y, X, 8-bit source value(256 extra for saturation)
 
+   /* Scanout dirty tracking. VRAM is split in 32 rows of 16 64x16
+    * (native) pixel blocks, a bit is set in DirtyCur when a block
+    * is written during the current frame, DirtyPrev holds the bits
+    * of the previous frame. */
+   uint16 DirtyCur[32];
+   uint16 DirtyPrev[32];
+   uint32 ScanoutFrame;
+   bool ScanoutSkip;       // Unchanged lines may be left as they are in the surface
+   bool ScanoutChanged;    // At least one output line was rewritten this frame
+   scanout_line ScanoutLines[SCANOUT_MAX_LINES];
+
+   /* Deinterlacing. Each field is scanned out to its own rows of the
+    * output surface, the rows of the other field still hold the
+    * previous field (weave). When that field doesn't match the
+    * current one (first interlaced frame, mode change) the lines of
+    * the current field are doubled instead (bob). */
+   uint32 DeintPrevField;  // Geometry of the previous field, 0 if none
+   bool DeintBob;
+
    /*
    VRAM has to be a ptr type or else we have to rely on smartcode void* shenanigans to
    wrestle a variable-sized struct.
@@ -248,6 +285,12 @@ void GPU_set_display_change_count(unsigned a);
 
 unsigned GPU_get_display_change_count(void);
 
+void GPU_set_scanout_skip(bool enable);
+
+bool GPU_get_scanout_changed(void);
+
+void GPU_InvalidateScanout(void);
+
 void GPU_Init(bool pal_clock_and_tv,
       int sls, int sle, uint8 upscale_shift);
 
@@ -261,6 +304,11 @@ void GPU_Rescale(uint8 ushift);
 
 int32_t GPU_Update(const int32_t sys_timestamp);
 
+/* Catches the GPU up to 'timestamp' and reschedules its event. Must
+ * surround accesses that can observe or change the line timing, since
+ * an idle GPU only gets an event on the scanlines that matter. */
+void GPU_Sync(const int32_t timestamp);
+
 void GPU_FillVideoParams(MDFNGI* gi);
 
 void GPU_Power(void);
@@ -283,4 +331,14 @@ int32_t GPU_GetScanlineNum(void);
 
 void texel_put(uint32 x, uint32 y, uint16 v);
 
+#ifdef GPU_TRACE
+void GPU_TraceReplayGP0(uint32 V, uint32 addr);
+
+void GPU_TraceReplayFlush(void);
+
+void GPU_TraceCounters(uint64 *commands, uint64 *primitives);
+
+void GPU_TraceHashVRAM(uint8 digest[16]);
+#endif
+
 #endif
@@ -1,18 +1,235 @@
 extern enum dither_mode psx_gpu_dither_mode;
 
+#ifdef HAVE_TILED_VRAM
+/* Upscaled VRAM is stored as 32x64 pixel tiles (4KB, one page each),
+ * row-major inside a tile and tile-row-major across VRAM, so that
+ * vertically neighbouring pixels share pages and cache lines.
+ * vram_tile_shift is log2 of the tile height, or 0 for the linear
+ * layout which is always used at 1x: the hardware renderers and the
+ * savestate code access the 1x VRAM directly. */
+#define VRAM_TILE_W_SHIFT 5
+#define VRAM_TILE_H_SHIFT 6
+
+#define vram_index(gpu, x, y) \
+   ((((y) >> (gpu)->vram_tile_shift) << (10 + (gpu)->upscale_shift + (gpu)->vram_tile_shift)) \
+    | (((x) >> VRAM_TILE_W_SHIFT) << (VRAM_TILE_W_SHIFT + (gpu)->vram_tile_shift)) \
+    | (((y) & ((1 << (gpu)->vram_tile_shift) - 1)) << VRAM_TILE_W_SHIFT) \
+    | ((x) & ((1 << VRAM_TILE_W_SHIFT) - 1)))
+
+/* Number of pixels from (upscaled) column x that are contiguous in memory */
+#define vram_run(gpu, x) ((gpu)->vram_tile_shift \
+      ? (1U << VRAM_TILE_W_SHIFT) - ((x) & ((1 << VRAM_TILE_W_SHIFT) - 1)) \
+      : (1024U << (gpu)->upscale_shift) - (x))
+#else
+#define vram_index(gpu, x, y) (((y) << (10 + (gpu)->upscale_shift)) | (x))
+
+#define vram_run(gpu, x)      ((1024U << (gpu)->upscale_shift) - (x))
+#endif
+
 /* Return a pixel from VRAM */
-#define vram_fetch(gpu, x, y)  ((gpu)->vram[((y) << (10 + (gpu)->upscale_shift)) | (x)])
+#define vram_fetch(gpu, x, y)  ((gpu)->vram[vram_index((gpu), (x), (y))])
 
 /* Return a pixel from VRAM, ignoring the internal upscaling */
 #define texel_fetch(gpu, x, y) vram_fetch((gpu), (x) << (gpu)->upscale_shift, (y) << (gpu)->upscale_shift)
 
 /* Set a pixel in VRAM */
-#define vram_put(gpu, x, y, v) (gpu)->vram[((y) << (10 + (gpu)->upscale_shift)) | (x)] = (v)
+#define vram_put(gpu, x, y, v) (gpu)->vram[vram_index((gpu), (x), (y))] = (v)
+
+/* Return a pointer to an (upscaled) VRAM pixel, valid for vram_run() pixels */
+#define vram_ptr(gpu, x, y)    (&(gpu)->vram[vram_index((gpu), (x), (y))])
 
 #define DitherEnabled(gpu)    (psx_gpu_dither_mode != DITHER_OFF && (gpu)->dtd)
 
 #define UPSCALE(gpu)          (1U << (gpu)->upscale_shift)
 
+/* Flag the native VRAM rectangle at (x, y) of size w x h as
+ * modified for the scanout dirty tracking. The rectangle wraps
+ * around VRAM edges like the GPU does. */
+static INLINE void MarkDirty(PS_GPU *gpu, int32_t x, int32_t y, int32_t w, int32_t h)
+{
+   uint32_t cols, c0, c1, r;
+
+   if(w <= 0 || h <= 0)
+      return;
+
+   if(w >= 1024)
+      cols = 0xFFFF;
+   else
+   {
+      c0 = (x & 1023) >> 6;
+      c1 = ((x + w - 1) & 1023) >> 6;
+
+      if(c0 <= c1)
+         cols = ((2U << c1) - 1) & ~((1U << c0) - 1);
+      else
+         cols = ((2U << c1) - 1) | (0xFFFF & ~((1U << c0) - 1));
+   }
+
+   if(h >= 512)
+      h = 512;
+
+   for(r = 0; r < (uint32_t)(((y & 15) + h + 15) >> 4); r++)
+      gpu->DirtyCur[((y >> 4) + r) & 31] |= cols;
+}
+
+/* MarkDirty() for an inclusive bounding box, clipped against
+ * the drawing area */
+static INLINE void MarkDirtyClipped(PS_GPU *gpu, int32_t x0, int32_t y0, int32_t x1, int32_t y1)
+{
+   x0 = std::max<int32_t>(x0, gpu->ClipX0);
+   y0 = std::max<int32_t>(y0, gpu->ClipY0);
+   x1 = std::min<int32_t>(x1, gpu->ClipX1);
+   y1 = std::min<int32_t>(y1, gpu->ClipY1);
+
+   MarkDirty(gpu, x0, y0, x1 + 1 - x0, y1 + 1 - y0);
+}
+
+/* Splits the span lo..hi into the ranges the rasterizers actually
+ * plot once coordinates wrap to 11 bits. Primitives are narrower than
+ * 2048, so a span wraps at most once. */
+static INLINE unsigned WrapDirtySpan(int32_t lo, int32_t hi, int32_t span[2][2])
+{
+   span[0][0] = lo & 2047;
+   span[0][1] = hi & 2047;
+
+   if((lo >> 11) == (hi >> 11))
+      return 1;
+
+   span[0][1] = 2047;
+   span[1][0] = 0;
+   span[1][1] = hi & 2047;
+   return 2;
+}
+
+/* MarkDirtyClipped() for a bounding box in unwrapped primitive
+ * coordinates */
+static INLINE void MarkDirtyWrapped(PS_GPU *gpu, int32_t x0, int32_t y0, int32_t x1, int32_t y1)
+{
+   int32_t xs[2][2], ys[2][2];
+   unsigned nx = WrapDirtySpan(x0, x1, xs);
+   unsigned ny = WrapDirtySpan(y0, y1, ys);
+   unsigned i, j;
+
+   for(j = 0; j < ny; j++)
+      for(i = 0; i < nx; i++)
+         MarkDirtyClipped(gpu, xs[i][0], ys[j][0], xs[i][1], ys[j][1]);
+}
+
+/* Fill 'count' contiguous VRAM pixels with 'v' */
+static INLINE void vram_fill_span(uint16_t *dst, uint16_t v, uint32_t count)
+{
+   uint32_t i = 0;
+
+#if defined(__SSE2__)
+   const __m128i v8 = _mm_set1_epi16(v);
+
+   for(; (i + 8) <= count; i += 8)
+      _mm_storeu_si128((__m128i *)&dst[i], v8);
+#endif
+
+   for(; i < count; i++)
+      dst[i] = v;
+}
+
+/* Copy 'count' contiguous VRAM pixels, skipping destination pixels
+ * with the mask bit set when mask_eval_and is non-zero and OR'ing
+ * mask_set_or into every written pixel. 'src' and 'dst' must not
+ * overlap. */
+static INLINE void vram_copy_span_masked(uint16_t *dst, const uint16_t *src,
+      uint32_t count, uint16_t mask_eval_and, uint16_t mask_set_or)
+{
+   uint32_t i = 0;
+
+#if defined(__SSE2__)
+   const __m128i set8 = _mm_set1_epi16(mask_set_or);
+
+   if(!mask_eval_and)
+   {
+      for(; (i + 8) <= count; i += 8)
+      {
+         __m128i s = _mm_loadu_si128((const __m128i *)&src[i]);
+         _mm_storeu_si128((__m128i *)&dst[i], _mm_or_si128(s, set8));
+      }
+   }
+   else
+   {
+      for(; (i + 8) <= count; i += 8)
+      {
+         __m128i s    = _mm_or_si128(_mm_loadu_si128((const __m128i *)&src[i]), set8);
+         __m128i d    = _mm_loadu_si128((const __m128i *)&dst[i]);
+         /* 0xFFFF for every destination pixel with bit 15 set */
+         __m128i keep = _mm_srai_epi16(d, 15);
+         _mm_storeu_si128((__m128i *)&dst[i],
+               _mm_or_si128(_mm_and_si128(keep, d), _mm_andnot_si128(keep, s)));
+      }
+   }
+#endif
+
+   for(; i < count; i++)
+   {
+      if(!(dst[i] & mask_eval_and))
+         dst[i] = src[i] | mask_set_or;
+   }
+}
+
+/* Row helpers working on 'count' (upscaled) pixels of VRAM row y from
+ * column x on, without wrapping. They split the row into runs that are
+ * contiguous in memory, which is the whole row for the linear layout. */
+static INLINE void vram_fill_row(PS_GPU *gpu, uint32_t x, uint32_t y,
+      uint16_t v, uint32_t count)
+{
+   while(count)
+   {
+      const uint32_t n = std::min<uint32_t>(count, vram_run(gpu, x));
+
+      vram_fill_span(vram_ptr(gpu, x, y), v, n);
+      x     += n;
+      count -= n;
+   }
+}
+
+static INLINE void vram_read_row(PS_GPU *gpu, uint32_t x, uint32_t y,
+      uint16_t *dst, uint32_t count)
+{
+   while(count)
+   {
+      const uint32_t n = std::min<uint32_t>(count, vram_run(gpu, x));
+
+      memcpy(dst, vram_ptr(gpu, x, y), n * sizeof(uint16_t));
+      dst   += n;
+      x     += n;
+      count -= n;
+   }
+}
+
+static INLINE void vram_write_row(PS_GPU *gpu, uint32_t x, uint32_t y,
+      const uint16_t *src, uint32_t count)
+{
+   while(count)
+   {
+      const uint32_t n = std::min<uint32_t>(count, vram_run(gpu, x));
+
+      memcpy(vram_ptr(gpu, x, y), src, n * sizeof(uint16_t));
+      src   += n;
+      x     += n;
+      count -= n;
+   }
+}
+
+static INLINE void vram_copy_row_masked(PS_GPU *gpu, uint32_t x, uint32_t y,
+      const uint16_t *src, uint32_t count, uint16_t mask_eval_and, uint16_t mask_set_or)
+{
+   while(count)
+   {
+      const uint32_t n = std::min<uint32_t>(count, vram_run(gpu, x));
+
+      vram_copy_span_masked(vram_ptr(gpu, x, y), src, n, mask_eval_and, mask_set_or);
+      src   += n;
+      x     += n;
+      count -= n;
+   }
+}
+
 template<int BlendMode>
 static INLINE void PlotPixelBlend(uint16_t bg_pix, uint16_t *fore_pix)
 {
@@ -115,6 +115,10 @@ static void DrawLine(PS_GPU *gpu, line_point *points)
 
    gpu->DrawTimeAvail -= k * 2;
 
+   MarkDirtyWrapped(gpu,
+         std::min(points[0].x, points[1].x), std::min(points[0].y, points[1].y),
+         std::max(points[0].x, points[1].x), std::max(points[0].y, points[1].y));
+
    line_points_to_fixed_point_step<goraud>(&points[0], &points[1], k, &step);
    line_point_to_fixed_point_coord<goraud>(&points[0], &step, &cur_point);
 
@@ -276,6 +276,12 @@ static INLINE void DrawTriangle(PS_GPU *gpu, tri_vertex *vertices)
    if(!CalcIDeltas<goraud, textured>(idl, vertices[0], vertices[1], vertices[2]))
       return;
 
+   MarkDirtyWrapped(gpu,
+         std::min(vertices[0].x, std::min(vertices[1].x, vertices[2].x)) >> gpu->upscale_shift,
+         vertices[0].y >> gpu->upscale_shift,
+         std::max(vertices[0].x, std::max(vertices[1].x, vertices[2].x)) >> gpu->upscale_shift,
+         vertices[2].y >> gpu->upscale_shift);
+
 
  // [0] should be top vertex, [2] should be bottom vertex, [1] should be off to the side vertex.
  //
@@ -1,4 +1,66 @@
 
+/* Row writers for sprites that are neither blended nor mask-tested. Every
+ * covered pixel is then a plain store, so a whole row (and its upscaled
+ * copies) can be written at once instead of going through texel_put. */
+static INLINE void SpriteRow_Fill(PS_GPU *gpu, int32_t x_start, int32_t x_bound,
+      int32_t y, uint16_t pix)
+{
+   const unsigned us    = gpu->upscale_shift;
+   const uint32_t count = (x_bound - x_start) << us;
+   uint32_t dy;
+
+   for (dy = 0; dy < UPSCALE(gpu); dy++)
+      vram_fill_row(gpu, x_start << us, ((y & 511) << us) + dy, pix, count);
+}
+
+/* pix holds the final VRAM values, solid is zero for transparent texels
+ * (which can't be told apart from pix alone once TexMult is applied). */
+static INLINE void SpriteRow_Copy(PS_GPU *gpu, int32_t x_start, int32_t x_bound,
+      int32_t y, const uint16_t *pix, const uint8_t *solid, bool opaque)
+{
+   const unsigned us    = gpu->upscale_shift;
+   const uint32_t count = x_bound - x_start;
+   const uint32_t row   = (y & 511) << us;
+   uint32_t dy, i;
+
+   if (opaque)
+   {
+      /* Expand the row once and store it to every sub-row */
+      static uint16_t expanded[1024 << 4];
+      const uint16_t *src = pix;
+
+      if (us)
+      {
+         for (i = 0; i < count; i++)
+            vram_fill_span(&expanded[i << us], pix[i], UPSCALE(gpu));
+         src = expanded;
+      }
+
+      for (dy = 0; dy < UPSCALE(gpu); dy++)
+         vram_write_row(gpu, x_start << us, row + dy, src, count << us);
+      return;
+   }
+
+   if (us == 0)
+   {
+      for (i = 0; i < count; i++)
+      {
+         if (solid[i])
+            vram_put(gpu, x_start + i, row, pix[i]);
+      }
+      return;
+   }
+
+   for (dy = 0; dy < UPSCALE(gpu); dy++)
+   {
+      for (i = 0; i < count; i++)
+      {
+         if (solid[i])
+            vram_fill_row(gpu, (x_start + i) << us, row + dy, pix[i], UPSCALE(gpu));
+      }
+   }
+}
+
 template<bool textured, int BlendMode, bool TexMult, uint32_t TexMode_TA,
    bool MaskEval_TA, bool FlipX, bool FlipY>
 static void DrawSprite(PS_GPU *gpu, int32_t x_arg, int32_t y_arg, int32_t w, int32_t h,
@@ -62,6 +124,8 @@ static void DrawSprite(PS_GPU *gpu, int32_t x_arg, int32_t y_arg, int32_t w, int
    if(y_bound > (gpu->ClipY1 + 1))
       y_bound = gpu->ClipY1 + 1;
 
+   MarkDirty(gpu, x_start, y_start, x_bound - x_start, y_bound - y_start);
+
    //HeightMode && !dfe && ((y & 1) == ((DisplayFB_YStart + !field_atvs) & 1)) && !DisplayOff
    //printf("%d:%d, %d, %d ---- heightmode=%d displayfb_ystart=%d field_atvs=%d displayoff=%d\n", w, h, scanline, dfe, HeightMode, DisplayFB_YStart, field_atvs, DisplayOff);
 
@@ -87,6 +151,46 @@ static void DrawSprite(PS_GPU *gpu, int32_t x_arg, int32_t y_arg, int32_t w, int
             gpu->DrawTimeAvail -= suck_time;
          }
 
+         if(BlendMode < 0 && !MaskEval_TA && x_bound > x_start)
+         {
+            if(!textured)
+            {
+               SpriteRow_Fill(gpu, x_start, x_bound, y, (fill_color & 0x7FFF) | gpu->MaskSetOR);
+               goto next_row;
+            }
+
+            /* Texels are fetched in the same order as below, so the texture
+             * cache and draw timing come out identical. The row is only
+             * written once it's fully decoded, which is wrong if the sprite
+             * samples the very line it draws to: leave that to the slow path. */
+            if((((v & gpu->SUCV.TWY_AND) + gpu->SUCV.TWY_ADD) & 511) != (uint32_t)(y & 511))
+            {
+               static uint16_t pix[1024];
+               static uint8_t solid[1024];
+               bool opaque = true;
+
+               for(int32_t x = x_start; MDFN_LIKELY(x < x_bound); x++)
+               {
+                  uint16_t fbw = GetTexel<TexMode_TA>(gpu, u_r, v);
+
+                  solid[x - x_start] = (fbw != 0);
+                  opaque &= (fbw != 0);
+
+                  if(TexMult && fbw)
+                  {
+                     uint8_t *dither_offset = gpu->DitherLUT[2][3];
+                     fbw = ModTexel(dither_offset, fbw, r, g, b);
+                  }
+                  pix[x - x_start] = fbw | gpu->MaskSetOR;
+
+                  u_r += u_inc;
+               }
+
+               SpriteRow_Copy(gpu, x_start, x_bound, y, pix, solid, opaque);
+               goto next_row;
+            }
+         }
+
          for(int32_t x = x_start; MDFN_LIKELY(x < x_bound); x++)
          {
             if(textured)
@@ -110,6 +214,7 @@ static void DrawSprite(PS_GPU *gpu, int32_t x_arg, int32_t y_arg, int32_t w, int
                u_r += u_inc;
          }
       }
+next_row:
       if(textured)
          v += v_inc;
    }
@@ -0,0 +1,359 @@
+/* GP0/GP1 command stream recorder and replayer.
+ *
+ * File layout (all values are host-endian 32-bit words):
+ *
+ *   "GPUTRACE" version pal
+ *   records...
+ *   GPU_TRACE_END
+ *
+ * Consecutive FIFO words are coalesced into a single GP0 record as long as
+ * their source addresses follow the same stride (0 for the GP0 port, 4 for
+ * DMA), so a traced frame stays close to the size of its display lists.
+ */
+
+#include "psx.h"
+#include "gpu_trace.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define GPU_TRACE_VERSION 1
+#define GPU_TRACE_BLOCK   4096
+
+enum
+{
+   GPU_TRACE_END = 0,
+   GPU_TRACE_POWER,
+   GPU_TRACE_FRAME,
+   GPU_TRACE_GP0,
+   GPU_TRACE_GP1,
+   GPU_TRACE_READ
+};
+
+static FILE *file;
+
+/* Pending GP0 block */
+static uint32_t block[GPU_TRACE_BLOCK];
+static uint32_t block_count;
+static uint32_t block_addr;
+static uint32_t block_stride;
+static int32_t block_timestamp;
+
+/* Pending run of VRAM reads */
+static uint32_t read_count;
+static int32_t read_timestamp;
+
+static void write_u32(uint32_t value)
+{
+   fwrite(&value, sizeof(value), 1, file);
+}
+
+static void flush_gp0(void)
+{
+   if (!block_count)
+      return;
+
+   write_u32(GPU_TRACE_GP0);
+   write_u32(block_timestamp);
+   write_u32(block_addr);
+   write_u32(block_stride);
+   write_u32(block_count);
+   fwrite(block, sizeof(uint32_t), block_count, file);
+
+   block_count = 0;
+}
+
+static void flush_read(void)
+{
+   if (!read_count)
+      return;
+
+   write_u32(GPU_TRACE_READ);
+   write_u32(read_timestamp);
+   write_u32(read_count);
+
+   read_count = 0;
+}
+
+static void flush_pending(void)
+{
+   flush_gp0();
+   flush_read();
+}
+
+void gpu_trace_init(const char *path, bool pal)
+{
+   if (file)
+      return;
+
+   file = fopen(path, "wb");
+   if (!file)
+   {
+      PSX_WARNING("[GPU] Couldn't open trace file \"%s\".", path);
+      return;
+   }
+
+   fwrite("GPUTRACE", 8, 1, file);
+   write_u32(GPU_TRACE_VERSION);
+   write_u32(pal);
+
+   block_count = 0;
+   read_count  = 0;
+}
+
+void gpu_trace_deinit(void)
+{
+   if (!file)
+      return;
+
+   flush_pending();
+   write_u32(GPU_TRACE_END);
+   fclose(file);
+   file = NULL;
+}
+
+void gpu_trace_power(void)
+{
+   if (!file)
+      return;
+
+   flush_pending();
+   write_u32(GPU_TRACE_POWER);
+}
+
+void gpu_trace_frame(void)
+{
+   if (!file)
+      return;
+
+   flush_pending();
+   write_u32(GPU_TRACE_FRAME);
+}
+
+void gpu_trace_gp0(int32_t timestamp, uint32_t addr, uint32_t V)
+{
+   if (!file)
+      return;
+
+   flush_read();
+
+   if (block_count)
+   {
+      uint32_t expected;
+
+      if (block_count == 1 && (addr == block_addr || addr == block_addr + 4))
+         block_stride = addr - block_addr;
+
+      expected = block_addr + block_stride * block_count;
+
+      if (addr != expected || block_count == GPU_TRACE_BLOCK)
+         flush_gp0();
+   }
+
+   if (!block_count)
+   {
+      block_timestamp = timestamp;
+      block_addr      = addr;
+      block_stride    = 0;
+   }
+
+   block[block_count++] = V;
+}
+
+void gpu_trace_gp1(int32_t timestamp, uint32_t V)
+{
+   if (!file)
+      return;
+
+   flush_pending();
+   write_u32(GPU_TRACE_GP1);
+   write_u32(timestamp);
+   write_u32(V);
+}
+
+void gpu_trace_read(int32_t timestamp)
+{
+   if (!file)
+      return;
+
+   flush_gp0();
+
+   if (!read_count)
+      read_timestamp = timestamp;
+   read_count++;
+}
+
+/*
+ * Replay
+ */
+
+struct gpu_trace_data
+{
+   size_t size;     /* In 32-bit words, header excluded */
+   uint32_t *words;
+};
+
+void *gpu_trace_load(const char *path, bool *pal)
+{
+   FILE *fp = fopen(path, "rb");
+   struct gpu_trace_data *trace;
+   char magic[8];
+   uint32_t header[2];
+   long size;
+
+   if (!fp)
+      return NULL;
+
+   if (fread(magic, 8, 1, fp) != 1 || memcmp(magic, "GPUTRACE", 8)
+         || fread(header, sizeof(header), 1, fp) != 1
+         || header[0] != GPU_TRACE_VERSION)
+   {
+      fclose(fp);
+      return NULL;
+   }
+
+   fseek(fp, 0, SEEK_END);
+   size = ftell(fp);
+   fseek(fp, 8 + sizeof(header), SEEK_SET);
+
+   if (size < 0)
+   {
+      fclose(fp);
+      return NULL;
+   }
+
+   size -= 8 + sizeof(header);
+
+   trace = (struct gpu_trace_data*)calloc(1, sizeof(*trace));
+
+   if (!trace)
+   {
+      fclose(fp);
+      return NULL;
+   }
+
+   trace->size  = size / sizeof(uint32_t);
+   trace->words = (uint32_t*)malloc(trace->size * sizeof(uint32_t));
+
+   if (!trace->words
+         || fread(trace->words, sizeof(uint32_t), trace->size, fp) != trace->size)
+   {
+      fclose(fp);
+      gpu_trace_free(trace);
+      return NULL;
+   }
+
+   fclose(fp);
+
+   *pal = header[1];
+   return trace;
+}
+
+void gpu_trace_free(void *trace)
+{
+   struct gpu_trace_data *data = (struct gpu_trace_data*)trace;
+
+   if (!data)
+      return;
+
+   free(data->words);
+   free(data);
+}
+
+bool gpu_trace_replay(const void *trace, struct gpu_trace_stats *stats)
+{
+   const struct gpu_trace_data *data = (const struct gpu_trace_data*)trace;
+   const uint32_t *p   = data->words;
+   const uint32_t *end = data->words + data->size;
+   bool ok             = false;
+   uint64 commands_start, primitives_start;
+   uint64 commands, primitives;
+
+   memset(stats, 0, sizeof(*stats));
+   GPU_TraceCounters(&commands_start, &primitives_start);
+
+#define NEED(n) if ((size_t)(end - p) < (size_t)(n)) goto done
+
+   for (;;)
+   {
+      uint32_t type;
+
+      NEED(1);
+      type = *p++;
+
+      switch (type)
+      {
+         case GPU_TRACE_END:
+            ok = true;
+            goto done;
+
+         case GPU_TRACE_POWER:
+            GPU_Power();
+            break;
+
+         case GPU_TRACE_FRAME:
+            stats->frames++;
+            break;
+
+         case GPU_TRACE_GP0:
+            {
+               uint32_t addr, stride, count, i;
+
+               NEED(4);
+               /* p[0] is the timestamp */
+               addr   = p[1];
+               stride = p[2];
+               count  = p[3];
+               p     += 4;
+
+               NEED(count);
+               for (i = 0; i < count; i++, addr += stride)
+                  GPU_TraceReplayGP0(p[i], addr);
+               p += count;
+
+               stats->gp0_words += count;
+            }
+            break;
+
+         case GPU_TRACE_GP1:
+            NEED(2);
+            GPU_Write(p[0], 4, p[1]);
+            p += 2;
+            stats->gp1_writes++;
+            break;
+
+         case GPU_TRACE_READ:
+            {
+               uint32_t i;
+
+               NEED(2);
+               for (i = 0; i < p[1]; i++)
+                  GPU_ReadDMA();
+               p += 2;
+
+               GPU_TraceReplayFlush();
+            }
+            break;
+
+         default:
+            goto done;
+      }
+   }
+
+#undef NEED
+
+done:
+   /* A trace from a session that was never shut down has no END record. */
+   if (p == end)
+      ok = true;
+
+   GPU_TraceReplayFlush();
+   GPU_TraceCounters(&commands, &primitives);
+   stats->commands   = commands - commands_start;
+   stats->primitives = primitives - primitives_start;
+
+   GPU_TraceHashVRAM(stats->vram_md5);
+
+   return ok;
+}
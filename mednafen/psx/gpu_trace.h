@@ -0,0 +1,42 @@
+#ifndef __MDFN_PSX_GPU_TRACE_H
+#define __MDFN_PSX_GPU_TRACE_H
+
+#include <stdint.h>
+
+/* GP0/GP1 command stream recorder.
+ *
+ * Captures every word that enters the GPU command FIFO (from the GP0 port
+ * or from DMA), every GP1 control write and every data read, so the
+ * software rasterizer can be replayed and benchmarked without running the
+ * CPU. Only built when GPU_TRACE is defined; recording is enabled by
+ * pointing the GPU_TRACE environment variable at an output file.
+ */
+
+struct gpu_trace_stats
+{
+   uint64_t frames;
+   uint64_t gp0_words;
+   uint64_t gp1_writes;
+   uint64_t commands;
+   uint64_t primitives;
+   uint8_t vram_md5[16];
+};
+
+void gpu_trace_init(const char *path, bool pal);
+void gpu_trace_deinit(void);
+
+void gpu_trace_power(void);
+void gpu_trace_frame(void);
+void gpu_trace_gp0(int32_t timestamp, uint32_t addr, uint32_t V);
+void gpu_trace_gp1(int32_t timestamp, uint32_t V);
+void gpu_trace_read(int32_t timestamp);
+
+/* Loads a whole trace into memory, returns NULL on failure. */
+void *gpu_trace_load(const char *path, bool *pal);
+void gpu_trace_free(void *trace);
+
+/* Replays a loaded trace into an initialized GPU. Returns false if the
+ * trace is truncated or malformed. */
+bool gpu_trace_replay(const void *trace, struct gpu_trace_stats *stats);
+
+#endif
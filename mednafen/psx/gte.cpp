@@ -31,6 +31,12 @@ extern bool psx_gte_overclock;
 
 #include "../clamp.h"
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
 /* Notes:
 
  AVSZ3/AVSZ4:
@@ -42,6 +48,7 @@ extern bool psx_gte_overclock;
 	Bits present mask: 0xfffff000
 
 	Checksum bit can't be directly set, it's apparently calculated like (bool)(FLAGS & 0x7f87e000)
+	(CR[31] holds the raw flags, the checksum is only materialized by GTE_ReadCR).
 
 	Instructions effectively clear it 0 at start. (todo: test "invalid" instructions)
 
@@ -371,7 +378,7 @@ void GTE_WriteCR(unsigned int which, uint32_t value)
          break;
 
       case 31:
-         CR[31] = (value & 0x7ffff000) | ((value & 0x7f87e000) ? (1 << 31) : 0);
+         CR[31] = value & 0x7ffff000;
          break;
    }
 }
@@ -418,6 +425,8 @@ uint32_t GTE_ReadCR(unsigned int which)
 
       case 31:
          ret = CR[31];
+         if(ret & 0x7f87e000)
+            ret |= 1 << 31;
          break;
    }
 
@@ -788,21 +797,6 @@ static INLINE int16_t i32_to_i16_saturate(unsigned int which, int32_t value, int
    return(value);
 }
 
-static INLINE int16_t Lm_B_PTZ(unsigned int which, int32_t value, int32_t ftv_value, int lm)
-{
-   int32_t tmp = lm << 15;
-
-   if(ftv_value < -32768)
-      FLAGS |= 1 << (24 - which);
-
-   if(ftv_value > 32767)
-      FLAGS |= 1 << (24 - which);
-
-   clamp(&value, (-32768 + tmp), 32767);
-
-   return(value);
-}
-
 static INLINE uint8_t Lm_C(unsigned int which, int32_t value)
 {
    if(value & ~0xFF)
@@ -979,13 +973,54 @@ static INLINE uint8_t MAC_to_COLOR(uint8_t flag, int32_t mac)
    return c;
 }
 
+/* Turns a mask with bit N set for each saturated lane N (lanes 1-3 map to
+ * MAC1-3) into the matching FLAG bits, 'top' being the bit of lane 1. */
+static INLINE uint32_t LaneFlags(int mask, unsigned top)
+{
+   return (((mask >> 1) & 1) << top) | (((mask >> 2) & 1) << (top - 1)) | (((mask >> 3) & 1) << (top - 2));
+}
+
+#if !defined(__SSE2__) && (defined(__ARM_NEON__) || defined(__ARM_NEON))
+static INLINE int LaneMask(uint32x4_t v)
+{
+   return (vgetq_lane_u32(v, 1) & 2) | (vgetq_lane_u32(v, 2) & 4) | (vgetq_lane_u32(v, 3) & 8);
+}
+#endif
+
 static INLINE void MAC_to_RGB_FIFO(void)
 {
    RGB_FIFO[0] = RGB_FIFO[1];
    RGB_FIFO[1] = RGB_FIFO[2];
+#if defined(__SSE2__)
+   {
+      /* Lanes 1-3 hold MAC1-3 */
+      __m128i c  = _mm_srai_epi32(_mm_loadu_si128((const __m128i*)MAC), 4);
+      __m128i c8 = _mm_packus_epi16(_mm_packs_epi32(c, c), _mm_setzero_si128());
+      int m      = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(c,
+                  _mm_unpacklo_epi16(_mm_unpacklo_epi8(c8, _mm_setzero_si128()), _mm_setzero_si128()))));
+      uint32_t rgb = _mm_cvtsi128_si32(c8);
+
+      FLAGS |= LaneFlags(~m, 21);
+      RGB_FIFO[2].R = rgb >> 8;
+      RGB_FIFO[2].G = rgb >> 16;
+      RGB_FIFO[2].B = rgb >> 24;
+   }
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+   {
+      int32x4_t c  = vshrq_n_s32(vld1q_s32(MAC), 4);
+      uint8x8_t c8 = vqmovun_s16(vcombine_s16(vqmovn_s32(c), vdup_n_s16(0)));
+      uint32x4_t eq = vceqq_s32(c, vreinterpretq_s32_u32(vmovl_u16(vget_low_u16(vmovl_u8(c8)))));
+
+      FLAGS |= LaneFlags(~LaneMask(eq), 21);
+      RGB_FIFO[2].R = vget_lane_u8(c8, 1);
+      RGB_FIFO[2].G = vget_lane_u8(c8, 2);
+      RGB_FIFO[2].B = vget_lane_u8(c8, 3);
+   }
+#else
    RGB_FIFO[2].R = Lm_C(0, MAC[1] >> 4);
    RGB_FIFO[2].G = Lm_C(1, MAC[2] >> 4);
    RGB_FIFO[2].B = Lm_C(2, MAC[3] >> 4);
+#endif
    RGB_FIFO[2].CD = RGB.CD;
 }
 
@@ -1010,60 +1045,133 @@ static INLINE int16_t Lm_B(unsigned int which, int32_t value, int lm)
    return(value);
 }
 
-static INLINE void MAC_to_IR(int lm)
+/* Saturates MAC1-3 into IR1-3 and returns the IR1-3 flags in a single
+ * pass instead of testing each lane. */
+static INLINE uint32_t MAC_to_IR_Flags(int lm)
 {
+#if defined(__SSE2__)
+   __m128i mac = _mm_loadu_si128((const __m128i*)MAC);
+   __m128i ir  = _mm_packs_epi32(mac, mac);
+   int m;
+
+   if(lm)
+      ir = _mm_max_epi16(ir, _mm_setzero_si128());
+
+   m = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(mac,
+               _mm_srai_epi32(_mm_unpacklo_epi16(ir, ir), 16))));
+
+   /* Lane 0 is MAC0, keep IR0 */
+   _mm_storel_epi64((__m128i*)IR, _mm_insert_epi16(ir, IR0, 0));
+
+   return LaneFlags(~m, 24);
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+   int32x4_t mac = vld1q_s32(MAC);
+   int16x4_t ir  = vqmovn_s32(mac);
+
+   if(lm)
+      ir = vmax_s16(ir, vdup_n_s16(0));
+
+   vst1_s16(IR, vset_lane_s16(IR0, ir, 0));
+
+   return LaneFlags(~LaneMask(vceqq_s32(mac, vmovl_s16(ir))), 24);
+#else
+   uint32_t prev_flags = FLAGS;
+   uint32_t flags;
+
+   FLAGS = 0;
    IR1 = i32_to_i16_saturate(0, MAC[1], lm);
    IR2 = i32_to_i16_saturate(1, MAC[2], lm);
    IR3 = i32_to_i16_saturate(2, MAC[3], lm);
+   flags = FLAGS;
+   FLAGS = prev_flags;
+
+   return flags;
+#endif
+}
+
+static INLINE void MAC_to_IR(int lm)
+{
+   FLAGS |= MAC_to_IR_Flags(lm);
+}
+
+/* Every step of a matrix row accumulates into a 44-bit MAC: starting from
+ * crv << 12 and adding three 16x16 products of at most 2^30 each, no
+ * intermediate sum can leave the 44-bit range as long as |crv| stays below
+ * 2^31 - 2^20. That holds for any sane translation/colour vector, so the
+ * per-step A_MV checks and wraps can then be skipped entirely. */
+static INLINE bool CRVectorInRange(const int32_t *crv)
+{
+   return ((uint32_t)crv[0] + 0x7FF00000U) <= 0xFFE00000U
+       && ((uint32_t)crv[1] + 0x7FF00000U) <= 0xFFE00000U
+       && ((uint32_t)crv[2] + 0x7FF00000U) <= 0xFFE00000U;
 }
 
 static INLINE void MultiplyMatrixByVector(const gtematrix *matrix, const int16_t *v, const int32_t *crv, uint32_t sf, int lm)
 {
+   int32_t mulr[3][3];
    unsigned i;
 
    for(i = 0; i < 3; i++)
    {
-      int64_t tmp;
-      int32_t mulr[3];
-
-      tmp = (uint64_t)(int64_t)crv[i] << 12;
-
       if(matrix == &Matrices.AbbyNormal)
       {
          if(i == 0)
          {
-            mulr[0] = -(RGB.R << 4);
-            mulr[1] = (RGB.R << 4);
-            mulr[2] = IR0;
+            mulr[i][0] = -(RGB.R << 4);
+            mulr[i][1] = (RGB.R << 4);
+            mulr[i][2] = IR0;
          }
          else
          {
-            mulr[0] = (int16_t)CR[i];
-            mulr[1] = (int16_t)CR[i];
-            mulr[2] = (int16_t)CR[i];
+            mulr[i][0] = (int16_t)CR[i];
+            mulr[i][1] = (int16_t)CR[i];
+            mulr[i][2] = (int16_t)CR[i];
          }
       }
       else
       {
-         mulr[0] = matrix->MX[i][0];
-         mulr[1] = matrix->MX[i][1];
-         mulr[2] = matrix->MX[i][2];
+         mulr[i][0] = matrix->MX[i][0];
+         mulr[i][1] = matrix->MX[i][1];
+         mulr[i][2] = matrix->MX[i][2];
       }
-      mulr[0] *= v[0];
-      mulr[1] *= v[1];
-      mulr[2] *= v[2];
+      mulr[i][0] *= v[0];
+      mulr[i][1] *= v[1];
+      mulr[i][2] *= v[2];
+   }
 
-      tmp = A_MV(i, tmp + mulr[0]);
-      if(crv == CRVectors.FC)
+   if(CRVectorInRange(crv))
+   {
+      for(i = 0; i < 3; i++)
       {
-         Lm_B(i, tmp >> sf, false);
-         tmp = 0;
+         int64_t tmp = (int64_t)((uint64_t)(int64_t)crv[i] << 12) + mulr[i][0];
+
+         if(crv == CRVectors.FC)
+         {
+            Lm_B(i, tmp >> sf, false);
+            tmp = 0;
+         }
+
+         MAC[1 + i] = (tmp + mulr[i][1] + mulr[i][2]) >> sf;
       }
+   }
+   else
+   {
+      for(i = 0; i < 3; i++)
+      {
+         int64_t tmp = (uint64_t)(int64_t)crv[i] << 12;
 
-      tmp = A_MV(i, tmp + mulr[1]);
-      tmp = A_MV(i, tmp + mulr[2]);
+         tmp = A_MV(i, tmp + mulr[i][0]);
+         if(crv == CRVectors.FC)
+         {
+            Lm_B(i, tmp >> sf, false);
+            tmp = 0;
+         }
 
-      MAC[1 + i] = tmp >> sf;
+         tmp = A_MV(i, tmp + mulr[i][1]);
+         tmp = A_MV(i, tmp + mulr[i][2]);
+
+         MAC[1 + i] = tmp >> sf;
+      }
    }
 
    MAC_to_IR(lm);
@@ -1072,34 +1180,53 @@ static INLINE void MultiplyMatrixByVector(const gtematrix *matrix, const int16_t
 static INLINE void MultiplyMatrixByVector_PT(const gtematrix *matrix, const int16_t *v, const int32_t *crv, uint32_t sf, int lm)
 {
    int64_t tmp[3];
+   int32_t ftv;
    unsigned i;
 
-   for(i = 0; i < 3; i++)
+   if(CRVectorInRange(crv))
    {
-      int32_t mulr[3];
+      for(i = 0; i < 3; i++)
+      {
+         tmp[i] = (int64_t)((uint64_t)(int64_t)crv[i] << 12)
+            + matrix->MX[i][0] * v[0]
+            + matrix->MX[i][1] * v[1]
+            + matrix->MX[i][2] * v[2];
 
-      tmp[i] = (uint64_t)(int64_t)crv[i] << 12;
+         MAC[1 + i] = tmp[i] >> sf;
+      }
+   }
+   else
+   {
+      for(i = 0; i < 3; i++)
+      {
+         int32_t mulr[3];
 
-      mulr[0] = matrix->MX[i][0] * v[0];
-      mulr[1] = matrix->MX[i][1] * v[1];
-      mulr[2] = matrix->MX[i][2] * v[2];
+         tmp[i] = (uint64_t)(int64_t)crv[i] << 12;
 
-      tmp[i] = A_MV(i, tmp[i] + mulr[0]);
-      tmp[i] = A_MV(i, tmp[i] + mulr[1]);
-      tmp[i] = A_MV(i, tmp[i] + mulr[2]);
+         mulr[0] = matrix->MX[i][0] * v[0];
+         mulr[1] = matrix->MX[i][1] * v[1];
+         mulr[2] = matrix->MX[i][2] * v[2];
 
-      MAC[1 + i] = tmp[i] >> sf;
+         tmp[i] = A_MV(i, tmp[i] + mulr[0]);
+         tmp[i] = A_MV(i, tmp[i] + mulr[1]);
+         tmp[i] = A_MV(i, tmp[i] + mulr[2]);
+
+         MAC[1 + i] = tmp[i] >> sf;
+      }
    }
 
-   IR1 = Lm_B(0, MAC[1], lm);
-   IR2 = Lm_B(1, MAC[2], lm);
    //printf("FTV: %08x %08x\n", crv[2], (uint32)(tmp[2] >> 12));
-   IR3 = Lm_B_PTZ(2, MAC[3], tmp[2] >> 12, lm);
+   ftv = tmp[2] >> 12;
+
+   /* IR3 is clamped from MAC3 but flagged from the unshifted Z */
+   FLAGS |= MAC_to_IR_Flags(lm) & ~(1 << 22);
+   if(ftv < -32768 || ftv > 32767)
+      FLAGS |= 1 << 22;
 
    Z_FIFO[0] = Z_FIFO[1];
    Z_FIFO[1] = Z_FIFO[2];
    Z_FIFO[2] = Z_FIFO[3];
-   Z_FIFO[3] = Lm_D(tmp[2] >> 12, true);
+   Z_FIFO[3] = Lm_D(ftv, true);
 }
 
 #define DECODE_FIELDS							\
@@ -1242,6 +1369,9 @@ static INLINE int32 RTPS(uint32 instr)
  return(15);
 }
 
+/* The three vertices only share the FIFOs, but each still needs its own
+ * UNR divide and an in-order PGXP push, and the MAC sums need 64-bit lanes
+ * that SSE2 lacks, so they're transformed one after another. */
 static INLINE int32 RTPT(uint32 instr)
 {
  DECODE_FIELDS;
@@ -1929,9 +2059,6 @@ int32_t GTE_Instruction(uint32_t instr)
    if (psx_gte_overclock)
       ret = 1;
 
-   if(FLAGS & 0x7f87e000)
-      FLAGS |= 1 << 31;
-
    CR[31] = FLAGS;
 
    return(ret - 1);
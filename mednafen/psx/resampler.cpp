@@ -0,0 +1,225 @@
+/* Polyphase resampler for the SPU output.
+ *
+ * A 32-tap Kaiser-windowed sinc evaluated at 1024 fractional positions. The
+ * cutoff sits at 90% of the lower of the two Nyquist rates, so the same
+ * table serves upsampling (48kHz, 96kHz) and downsampling (32kHz, 22kHz).
+ *
+ * Input frames are kept in planar form so each output frame is two plain
+ * 16-bit dot products against one table row.
+ */
+
+#include "psx.h"
+#include "resampler.h"
+#include "../clamp.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#define RESAMPLER_IN_RATE     44100
+#define RESAMPLER_TAPS        32
+#define RESAMPLER_PHASE_BITS  10
+#define RESAMPLER_PHASES      (1 << RESAMPLER_PHASE_BITS)
+#define RESAMPLER_MAX_IN      4096    /* Size of IntermediateBuffer */
+#define RESAMPLER_HISTORY     (RESAMPLER_MAX_IN + 2 * RESAMPLER_TAPS)
+
+/* Output gain, the headroom IntermediateBuffer normally has applied */
+#define RESAMPLER_GAIN        0.75
+
+static int16_t coefs[RESAMPLER_PHASES][RESAMPLER_TAPS];
+
+static int16_t history[2][RESAMPLER_HISTORY];
+static unsigned history_count;
+
+/* Position of the next output frame in history[], 32.32 fixed point */
+static uint64_t pos;
+static uint64_t step;
+
+static int16_t *out_buffer;
+
+static double bessel_i0(double x)
+{
+   double sum  = 1.0;
+   double term = 1.0;
+   unsigned k;
+
+   for (k = 1; k < 32; k++)
+   {
+      term *= (x / (2 * k)) * (x / (2 * k));
+      sum  += term;
+   }
+
+   return sum;
+}
+
+static void init_coefs(double cutoff)
+{
+   const double pi   = 3.14159265358979323846;
+   const double beta = 8.0;
+   unsigned phase, i;
+
+   for (phase = 0; phase < RESAMPLER_PHASES; phase++)
+   {
+      double taps[RESAMPLER_TAPS];
+      double sum   = 0.0;
+      int32_t isum = 0;
+      unsigned peak = 0;
+
+      for (i = 0; i < RESAMPLER_TAPS; i++)
+      {
+         const double x = (double)i - (RESAMPLER_TAPS / 2 - 1) - (double)phase / RESAMPLER_PHASES;
+         const double w = x / (RESAMPLER_TAPS / 2);
+         const double t = 2.0 * cutoff * x;
+         double sinc    = 1.0;
+
+         if (fabs(t) > 1e-9)
+            sinc = sin(pi * t) / (pi * t);
+
+         taps[i] = sinc * bessel_i0(beta * sqrt(fmax(0.0, 1.0 - w * w))) / bessel_i0(beta);
+         sum    += taps[i];
+      }
+
+      /* Normalize each row on its own, and put the rounding error on the
+       * largest tap, so every phase has exactly the same DC gain. */
+      for (i = 0; i < RESAMPLER_TAPS; i++)
+      {
+         coefs[phase][i] = (int16_t)lrint(taps[i] / sum * RESAMPLER_GAIN * 32768);
+         isum += coefs[phase][i];
+
+         if (abs(coefs[phase][i]) > abs(coefs[phase][peak]))
+            peak = i;
+      }
+
+      coefs[phase][peak] += (int32_t)lrint(RESAMPLER_GAIN * 32768) - isum;
+   }
+}
+
+bool Resampler_Init(unsigned out_rate)
+{
+   Resampler_Kill();
+
+   if (!out_rate)
+      return false;
+
+   out_buffer = (int16_t*)malloc(((uint64_t)RESAMPLER_MAX_IN * out_rate / RESAMPLER_IN_RATE + 4) * 2 * sizeof(int16_t));
+   if (!out_buffer)
+      return false;
+
+   init_coefs(0.45 * (out_rate < RESAMPLER_IN_RATE ? (double)out_rate / RESAMPLER_IN_RATE : 1.0));
+
+   step = ((uint64_t)RESAMPLER_IN_RATE << 32) / out_rate;
+   pos  = 0;
+
+   /* Start centered on the first input frame */
+   memset(history, 0, sizeof(history));
+   history_count = RESAMPLER_TAPS / 2 - 1;
+
+   return true;
+}
+
+void Resampler_Kill(void)
+{
+   if (out_buffer)
+      free(out_buffer);
+   out_buffer = NULL;
+}
+
+unsigned Resampler_Process(const int16_t *in, unsigned in_frames, int16_t **out)
+{
+   int16_t *dst = out_buffer;
+   unsigned i, consumed;
+
+   if (in_frames > RESAMPLER_MAX_IN)
+      in_frames = RESAMPLER_MAX_IN;
+
+   for (i = 0; i < in_frames; i++)
+   {
+      history[0][history_count + i] = in[i * 2 + 0];
+      history[1][history_count + i] = in[i * 2 + 1];
+   }
+   history_count += in_frames;
+
+   while ((unsigned)(pos >> 32) + RESAMPLER_TAPS <= history_count)
+   {
+      const int16_t *l = &history[0][pos >> 32];
+      const int16_t *r = &history[1][pos >> 32];
+      const int16_t *c = coefs[(uint32_t)pos >> (32 - RESAMPLER_PHASE_BITS)];
+#if defined(__SSE2__)
+      __m128i sum_l = _mm_setzero_si128();
+      __m128i sum_r = _mm_setzero_si128();
+      __m128i sum;
+      uint32_t packed;
+
+      for (i = 0; i < RESAMPLER_TAPS; i += 8)
+      {
+         const __m128i cv = _mm_loadu_si128((const __m128i*)&c[i]);
+
+         sum_l = _mm_add_epi32(sum_l, _mm_madd_epi16(_mm_loadu_si128((const __m128i*)&l[i]), cv));
+         sum_r = _mm_add_epi32(sum_r, _mm_madd_epi16(_mm_loadu_si128((const __m128i*)&r[i]), cv));
+      }
+
+      /* L and R totals in lanes 0 and 1 */
+      sum    = _mm_add_epi32(_mm_unpacklo_epi32(sum_l, sum_r), _mm_unpackhi_epi32(sum_l, sum_r));
+      sum    = _mm_add_epi32(sum, _mm_srli_si128(sum, 8));
+      sum    = _mm_srai_epi32(_mm_add_epi32(sum, _mm_set1_epi32(1 << 14)), 15);
+      packed = _mm_cvtsi128_si32(_mm_packs_epi32(sum, sum));
+      memcpy(dst, &packed, sizeof(packed));
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+      int32x4_t sum_l = vdupq_n_s32(0);
+      int32x4_t sum_r = vdupq_n_s32(0);
+      int32x2_t sum;
+
+      for (i = 0; i < RESAMPLER_TAPS; i += 8)
+      {
+         const int16x8_t cv = vld1q_s16(&c[i]);
+         const int16x8_t lv = vld1q_s16(&l[i]);
+         const int16x8_t rv = vld1q_s16(&r[i]);
+
+         sum_l = vmlal_s16(sum_l, vget_low_s16(lv), vget_low_s16(cv));
+         sum_l = vmlal_s16(sum_l, vget_high_s16(lv), vget_high_s16(cv));
+         sum_r = vmlal_s16(sum_r, vget_low_s16(rv), vget_low_s16(cv));
+         sum_r = vmlal_s16(sum_r, vget_high_s16(rv), vget_high_s16(cv));
+      }
+
+      /* L and R totals in lanes 0 and 1 */
+      sum = vpadd_s32(vadd_s32(vget_low_s32(sum_l), vget_high_s32(sum_l)),
+            vadd_s32(vget_low_s32(sum_r), vget_high_s32(sum_r)));
+      vst1_lane_s32((int32_t*)dst, vreinterpret_s32_s16(vqrshrn_n_s32(vcombine_s32(sum, sum), 15)), 0);
+#else
+      int32_t sum_l = 0;
+      int32_t sum_r = 0;
+
+      for (i = 0; i < RESAMPLER_TAPS; i++)
+      {
+         sum_l += l[i] * c[i];
+         sum_r += r[i] * c[i];
+      }
+
+      sum_l = (sum_l + (1 << 14)) >> 15;
+      sum_r = (sum_r + (1 << 14)) >> 15;
+      clamp(&sum_l, -32768, 32767);
+      clamp(&sum_r, -32768, 32767);
+
+      dst[0] = sum_l;
+      dst[1] = sum_r;
+#endif
+      dst += 2;
+      pos += step;
+   }
+
+   /* Keep only the frames later output frames still need */
+   consumed = pos >> 32;
+   memmove(history[0], &history[0][consumed], (history_count - consumed) * sizeof(int16_t));
+   memmove(history[1], &history[1][consumed], (history_count - consumed) * sizeof(int16_t));
+   history_count -= consumed;
+   pos           -= (uint64_t)consumed << 32;
+
+   *out = out_buffer;
+   return (dst - out_buffer) / 2;
+}
@@ -0,0 +1,20 @@
+#ifndef __MDFN_PSX_RESAMPLER_H
+#define __MDFN_PSX_RESAMPLER_H
+
+#include <stdint.h>
+
+/* Polyphase resampler from the SPU's 44100Hz output to the rate reported to
+ * the frontend, so the frontend doesn't have to run its own generic one.
+ *
+ * Input is full-scale IntermediateBuffer data (IntermediateBufferHeadroom
+ * off); the 75% headroom gain is folded into the filter.
+ */
+
+bool Resampler_Init(unsigned out_rate);
+void Resampler_Kill(void);
+
+/* Resamples in_frames stereo frames and returns the number of frames stored
+ * in *out, which stays valid until the next call. */
+unsigned Resampler_Process(const int16_t *in, unsigned in_frames, int16_t **out);
+
+#endif
@@ -73,8 +73,15 @@
 
 #include "../state_helpers.h"
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
 uint32_t IntermediateBufferPos;
 int16_t IntermediateBuffer[4096][2];
+bool IntermediateBufferHeadroom = true;
 
 //#define SPUIRQ_DBG(format, ...) { printf("[SPUIRQDBG] " format " -- Voice 22 CA=0x%06x,LA=0x%06x\n", ## __VA_ARGS__, Voices[22].CurAddr, Voices[22].LoopAddr); }
 
@@ -87,11 +94,182 @@ static const int16 FIR_Table[256][4] =
 #include "spu_fir_table.inc"
 };
 
+// Weights that make the interpolator pass a noise sample through unchanged:
+// (n * 0x4000 + n * 0x4000) >> 15 == n
+static const int16 Noise_FIR[4] = { 0x4000, 0x4000, 0, 0 };
+
+//
+// Per-sample voice mixer inputs, gathered from Voices[] in structure-of-arrays
+// form so interpolation, enveloping and volume can run on several voices at once.
+//
+// None of the FIR_Table rows has weights summing past 1.0 in magnitude, so an
+// interpolated (or noise) sample always fits in 16 bits; so does the enveloped
+// one, except for a noise sample of -32768 at an envelope level of 0x8000,
+// which is flagged through Wide.
+//
+struct SPU_MixState
+{
+   int16 Window[24][4];		// DecodeBuffer samples at the read position
+   int16 FIR[24][4];		// Interpolation weights for them
+   int16 Env[24];
+   int16 Vol[2][24];
+
+   int32 PreLRSample[24];
+
+   bool Wide;
+};
+
+static INLINE int32 MixVoice(const SPU_MixState *mix, unsigned v)
+{
+   int32 pvs = ((mix->Window[v][0] * mix->FIR[v][0]) +
+         (mix->Window[v][1] * mix->FIR[v][1]) +
+         (mix->Window[v][2] * mix->FIR[v][2]) +
+         (mix->Window[v][3] * mix->FIR[v][3])) >> 15;
+
+   return (pvs * mix->Env[v]) >> 15;
+}
+
+// Computes PreLRSample for all 24 voices and adds their L/R output to accum,
+// and to accum_fv for voices that have reverb enabled.
+static void MixVoices(SPU_MixState *mix, uint32 reverb_mode, int32 *accum, int32 *accum_fv)
+{
+#if defined(__SSE2__)
+   if(!mix->Wide)
+   {
+      const __m128i bits = _mm_set_epi32(8, 4, 2, 1);
+      __m128i sum[2], sum_fv[2];
+      int32 tmp[2][2][4];
+
+      sum[0] = sum[1] = sum_fv[0] = sum_fv[1] = _mm_setzero_si128();
+
+      for(unsigned g = 0; g < 24; g += 8)
+      {
+         __m128i pvs[2], pvs16, env, lo, hi, out[2], rv[2];
+
+         for(unsigned h = 0; h < 2; h++)
+         {
+            const unsigned v = g + h * 4;
+            // Two voices per register, tap pairs summed by madd
+            __m128i a = _mm_madd_epi16(_mm_loadu_si128((const __m128i*)mix->Window[v + 0]), _mm_loadu_si128((const __m128i*)mix->FIR[v + 0]));
+            __m128i b = _mm_madd_epi16(_mm_loadu_si128((const __m128i*)mix->Window[v + 2]), _mm_loadu_si128((const __m128i*)mix->FIR[v + 2]));
+            __m128 even = _mm_shuffle_ps(_mm_castsi128_ps(a), _mm_castsi128_ps(b), _MM_SHUFFLE(2, 0, 2, 0));
+            __m128 odd  = _mm_shuffle_ps(_mm_castsi128_ps(a), _mm_castsi128_ps(b), _MM_SHUFFLE(3, 1, 3, 1));
+
+            pvs[h] = _mm_srai_epi32(_mm_add_epi32(_mm_castps_si128(even), _mm_castps_si128(odd)), 15);
+            rv[h]  = _mm_cmpeq_epi32(_mm_and_si128(_mm_set1_epi32(reverb_mode >> v), bits), bits);
+         }
+
+         pvs16  = _mm_packs_epi32(pvs[0], pvs[1]);
+         env    = _mm_loadu_si128((const __m128i*)&mix->Env[g]);
+         lo     = _mm_mullo_epi16(pvs16, env);
+         hi     = _mm_mulhi_epi16(pvs16, env);
+         out[0] = _mm_srai_epi32(_mm_unpacklo_epi16(lo, hi), 15);
+         out[1] = _mm_srai_epi32(_mm_unpackhi_epi16(lo, hi), 15);
+
+         _mm_storeu_si128((__m128i*)&mix->PreLRSample[g + 0], out[0]);
+         _mm_storeu_si128((__m128i*)&mix->PreLRSample[g + 4], out[1]);
+
+         pvs16 = _mm_packs_epi32(out[0], out[1]);
+
+         for(unsigned lr = 0; lr < 2; lr++)
+         {
+            __m128i vol = _mm_loadu_si128((const __m128i*)&mix->Vol[lr][g]);
+            __m128i l0, l1;
+
+            lo = _mm_mullo_epi16(pvs16, vol);
+            hi = _mm_mulhi_epi16(pvs16, vol);
+            l0 = _mm_srai_epi32(_mm_unpacklo_epi16(lo, hi), 15);
+            l1 = _mm_srai_epi32(_mm_unpackhi_epi16(lo, hi), 15);
+
+            sum[lr]    = _mm_add_epi32(sum[lr], _mm_add_epi32(l0, l1));
+            sum_fv[lr] = _mm_add_epi32(sum_fv[lr], _mm_add_epi32(_mm_and_si128(l0, rv[0]), _mm_and_si128(l1, rv[1])));
+         }
+      }
+
+      for(unsigned lr = 0; lr < 2; lr++)
+      {
+         _mm_storeu_si128((__m128i*)tmp[lr][0], sum[lr]);
+         _mm_storeu_si128((__m128i*)tmp[lr][1], sum_fv[lr]);
+         accum[lr]    += tmp[lr][0][0] + tmp[lr][0][1] + tmp[lr][0][2] + tmp[lr][0][3];
+         accum_fv[lr] += tmp[lr][1][0] + tmp[lr][1][1] + tmp[lr][1][2] + tmp[lr][1][3];
+      }
+      return;
+   }
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+   if(!mix->Wide)
+   {
+      static const uint32 bit_table[4] = { 1, 2, 4, 8 };
+      const uint32x4_t bits = vld1q_u32(bit_table);
+      int32x4_t sum[2], sum_fv[2];
+
+      sum[0] = sum[1] = sum_fv[0] = sum_fv[1] = vdupq_n_s32(0);
+
+      for(unsigned g = 0; g < 24; g += 4)
+      {
+         // Deinterleaved so each register holds one tap of four voices
+         const int16x4x4_t w = vld4_s16(&mix->Window[g][0]);
+         const int16x4x4_t f = vld4_s16(&mix->FIR[g][0]);
+         int32x4_t pvs, out, rv;
+         int16x4_t out16;
+
+         pvs = vmull_s16(w.val[0], f.val[0]);
+         pvs = vmlal_s16(pvs, w.val[1], f.val[1]);
+         pvs = vmlal_s16(pvs, w.val[2], f.val[2]);
+         pvs = vmlal_s16(pvs, w.val[3], f.val[3]);
+         pvs = vshrq_n_s32(pvs, 15);
+
+         out = vshrq_n_s32(vmull_s16(vmovn_s32(pvs), vld1_s16(&mix->Env[g])), 15);
+         vst1q_s32(&mix->PreLRSample[g], out);
+
+         out16 = vmovn_s32(out);
+         rv    = vreinterpretq_s32_u32(vtstq_u32(vdupq_n_u32(reverb_mode >> g), bits));
+
+         for(unsigned lr = 0; lr < 2; lr++)
+         {
+            const int32x4_t l = vshrq_n_s32(vmull_s16(out16, vld1_s16(&mix->Vol[lr][g])), 15);
+
+            sum[lr]    = vaddq_s32(sum[lr], l);
+            sum_fv[lr] = vaddq_s32(sum_fv[lr], vandq_s32(l, rv));
+         }
+      }
+
+      for(unsigned lr = 0; lr < 2; lr++)
+      {
+         accum[lr]    += vgetq_lane_s32(sum[lr], 0) + vgetq_lane_s32(sum[lr], 1) + vgetq_lane_s32(sum[lr], 2) + vgetq_lane_s32(sum[lr], 3);
+         accum_fv[lr] += vgetq_lane_s32(sum_fv[lr], 0) + vgetq_lane_s32(sum_fv[lr], 1) + vgetq_lane_s32(sum_fv[lr], 2) + vgetq_lane_s32(sum_fv[lr], 3);
+      }
+      return;
+   }
+#endif
+
+   for(unsigned v = 0; v < 24; v++)
+   {
+      const int32 voice_pvs = MixVoice(mix, v);
+      const int32 l = (voice_pvs * mix->Vol[0][v]) >> 15;
+      const int32 r = (voice_pvs * mix->Vol[1][v]) >> 15;
+
+      mix->PreLRSample[v] = voice_pvs;
+
+      accum[0] += l;
+      accum[1] += r;
+
+      if(reverb_mode & (1 << v))
+      {
+         accum_fv[0] += l;
+         accum_fv[1] += r;
+      }
+   }
+}
+
 PS_SPU::PS_SPU()
 {
+   JournalCount = 0;
+   PendingSamples = 0;
+
    IntermediateBufferPos = 0;
    memset(IntermediateBuffer, 0, sizeof(IntermediateBuffer));
 
+   ResetDecodeCache();
 }
 
 PS_SPU::~PS_SPU()
@@ -100,6 +278,8 @@ PS_SPU::~PS_SPU()
 
 void PS_SPU::Power(void)
 {
+   Sync();
+
    clock_divider = 768;
 
    memset(SPURAM, 0, sizeof(SPURAM));
@@ -181,6 +361,46 @@ void PS_SPU::Power(void)
    ReverbCur = ReverbWA;
 
    IRQAsserted = false;
+
+   ResetDecodeCache();
+}
+
+void PS_SPU::ResetDecodeCache(void)
+{
+   memset(DecodeCache, 0, sizeof(DecodeCache));
+   DecodeCacheNextTag = 0;
+
+   for(unsigned i = 0; i < 24; i++)
+   {
+      Voices[i].DecodeCache = NULL;
+      Voices[i].DecodeCacheTag = 0;
+      Voices[i].DecodeCacheMatched = 0;
+   }
+}
+
+// Points the voice at the cache entry for the block it's starting to decode, claiming the entry if it
+// currently holds some other block.
+INLINE void PS_SPU::LookupDecodeCache(SPU_Voice *voice, uint32 addr, uint8 header)
+{
+   const uint32 hash = ((addr >> 3) ^ (header << 15) ^ ((uint32)(uint16)voice->DecodeM1 << 7) ^ ((uint32)(uint16)voice->DecodeM2 << 16)) * 0x9E3779B1;
+   SPU_DecodeCacheEntry *entry = &DecodeCache[hash >> (32 - SPU_DECODE_CACHE_BITS)];
+
+   if(!entry->Tag || entry->Addr != addr || entry->Header != header || entry->M1 != voice->DecodeM1 || entry->M2 != voice->DecodeM2)
+   {
+      if(!++DecodeCacheNextTag)
+         DecodeCacheNextTag = 1;
+
+      entry->Tag = DecodeCacheNextTag;
+      entry->Addr = addr;
+      entry->Header = header;
+      entry->Count = 0;
+      entry->M2 = voice->DecodeM2;
+      entry->M1 = voice->DecodeM1;
+   }
+
+   voice->DecodeCache = entry;
+   voice->DecodeCacheTag = entry->Tag;
+   voice->DecodeCacheMatched = 0;
 }
 
 static INLINE void CalcVCDelta(const uint8 zs, uint8 speed, bool log_mode, bool dec_mode, bool inv_increment, int16 Current, int &increment, int &divinco)
@@ -369,6 +589,8 @@ void PS_SPU::RunDecoder(SPU_Voice *voice)
          voice->DecodeWeight = (CV >> 4) & 0xF;
          voice->DecodeFlags = (CV >> 8) & 0xFF;
 
+         LookupDecodeCache(voice, voice->CurAddr, CV & 0xFF);
+
          if(voice->DecodeFlags & 0x4)
          {
             if(!voice->IgnoreSampLA)
@@ -391,45 +613,80 @@ void PS_SPU::RunDecoder(SPU_Voice *voice)
       // at higher rates will fail horribly.
       //
       {
-         const int32 weight_m1 = Weights[voice->DecodeWeight][0];
-         const int32 weight_m2 = Weights[voice->DecodeWeight][1];
-         uint16 CV;
-         unsigned shift;
-         uint32 coded;
+         SPU_DecodeCacheEntry *entry = voice->DecodeCache;
+         const unsigned word = (voice->CurAddr & 0x7) - 1;
+         const uint16 raw = SPURAM[voice->CurAddr];
          int16 *tb = &voice->DecodeBuffer[voice->DecodeWritePos];
 
-         CV = SPURAM[voice->CurAddr];
-         shift = voice->DecodeShift;
+         if(entry && entry->Tag != voice->DecodeCacheTag)
+            entry = voice->DecodeCache = NULL;
 
-         if(MDFN_UNLIKELY(shift > 12))
+         if(entry && word == voice->DecodeCacheMatched && word < entry->Count && entry->Words[word] == raw)
          {
-            //PSX_DBG(PSX_DBG_FLOOD, "[SPU] Buggy/Illegal ADPCM block shift value on voice %u: %u\n", (unsigned)(voice - Voices), shift);
-
-            shift = 8;
-            CV &= 0x8888;
+            memcpy(tb, &entry->Samples[word * 4], 4 * sizeof(int16));
+            voice->DecodeM2 = tb[2];
+            voice->DecodeM1 = tb[3];
+            voice->DecodeCacheMatched++;
          }
+         else
+         {
+            const int32 weight_m1 = Weights[voice->DecodeWeight][0];
+            const int32 weight_m2 = Weights[voice->DecodeWeight][1];
+            uint16 CV;
+            unsigned shift;
+            uint32 coded;
 
-         coded = (uint32)CV << 12;
+            CV = raw;
+            shift = voice->DecodeShift;
 
+            if(MDFN_UNLIKELY(shift > 12))
+            {
+               //PSX_DBG(PSX_DBG_FLOOD, "[SPU] Buggy/Illegal ADPCM block shift value on voice %u: %u\n", (unsigned)(voice - Voices), shift);
 
-         for(int i = 0; i < 4; i++)
-         {
-            int32 sample = (int16)(coded & 0xF000) >> shift;
+               shift = 8;
+               CV &= 0x8888;
+            }
+
+            coded = (uint32)CV << 12;
+
+
+            for(int i = 0; i < 4; i++)
+            {
+               int32 sample = (int16)(coded & 0xF000) >> shift;
 
-            sample += ((voice->DecodeM2 * weight_m2) >> 6);
-            sample += ((voice->DecodeM1 * weight_m1) >> 6);
+               sample += ((voice->DecodeM2 * weight_m2) >> 6);
+               sample += ((voice->DecodeM1 * weight_m1) >> 6);
 
-            clamp(&sample, -32768, 32767);
+               clamp(&sample, -32768, 32767);
 
-            tb[i] = sample;
-            voice->DecodeM2 = voice->DecodeM1;
-            voice->DecodeM1 = sample;
-            coded >>= 4;
+               tb[i] = sample;
+               voice->DecodeM2 = voice->DecodeM1;
+               voice->DecodeM1 = sample;
+               coded >>= 4;
+            }
+
+            // Every word of the entry was matched in order up to this one, so the filter history going into it
+            // matches too; anything else means the entry no longer describes what's in SPU RAM.
+            if(entry)
+            {
+               if(word == voice->DecodeCacheMatched && word == entry->Count)
+               {
+                  entry->Words[word] = raw;
+                  memcpy(&entry->Samples[word * 4], tb, 4 * sizeof(int16));
+                  entry->Count = word + 1;
+                  voice->DecodeCacheMatched++;
+               }
+               else
+               {
+                  entry->Tag = 0;
+                  voice->DecodeCache = NULL;
+               }
+            }
          }
-         voice->DecodeWritePos = (voice->DecodeWritePos + 4) & 0x1F;
-         voice->DecodeAvail += 4;
-         voice->CurAddr = (voice->CurAddr + 1) & 0x3FFFF;
       }
+      voice->DecodeWritePos = (voice->DecodeWritePos + 4) & 0x1F;
+      voice->DecodeAvail += 4;
+      voice->CurAddr = (voice->CurAddr + 1) & 0x3FFFF;
    }
 }
 
@@ -589,12 +846,12 @@ INLINE uint32 PS_SPU::Get_Reverb_Offset(uint32 in_offset)
  return(offset);
 }
 
-int16 NO_INLINE PS_SPU::RD_RVB(uint16 raw_offs, int32 extra_offs)
+INLINE int16 PS_SPU::RD_RVB(uint16 raw_offs, int32 extra_offs)
 {
  return ReadSPURAM(Get_Reverb_Offset((raw_offs << 2) + extra_offs));
 }
 
-void NO_INLINE PS_SPU::WR_RVB(uint16 raw_offs, int16 sample)
+INLINE void PS_SPU::WR_RVB(uint16 raw_offs, int16 sample)
 {
    WriteSPURAM(Get_Reverb_Offset(raw_offs << 2), sample);
 }
@@ -606,8 +863,58 @@ static const int16 ResampTable[20] =
  -1, 2, -10, 35, -103, 266, -616, 1332, -2960, 10246, 10246, -2960, 1332, -616, 266, -103, 35, -10, 2, -1,
 };
 
+#if defined(__SSE2__) || defined(__ARM_NEON__) || defined(__ARM_NEON)
+// ResampTable laid out for a plain dot product over every other input sample, middle included, and
+// padded to a multiple of 8 taps.
+static const int16 ResampTable4422[40] =
+{
+ -1, 0, 2, 0, -10, 0, 35, 0, -103, 0, 266, 0, -616, 0, 1332, 0, -2960, 0, 10246, 0x4000,
+ 10246, 0, -2960, 0, 1332, 0, -616, 0, 266, 0, -103, 0, 35, 0, -10, 0, 2, 0, -1, 0,
+};
+
+static const int16 ResampTable2244[24] =
+{
+ -1, 2, -10, 35, -103, 266, -616, 1332, -2960, 10246, 10246, -2960, 1332, -616, 266, -103, 35, -10, 2, -1,
+ 0, 0, 0, 0,
+};
+
+// count must be a multiple of 8; src[0 ... count - 1] are read.
+static INLINE int32 ReverbDot(const int16 *src, const int16 *table, unsigned count)
+{
+#if defined(__SSE2__)
+ __m128i sum = _mm_setzero_si128();
+
+ for(unsigned i = 0; i < count; i += 8)
+  sum = _mm_add_epi32(sum, _mm_madd_epi16(_mm_loadu_si128((const __m128i*)&src[i]), _mm_loadu_si128((const __m128i*)&table[i])));
+
+ sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(1, 0, 3, 2)));
+ sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));
+
+ return _mm_cvtsi128_si32(sum);
+#else
+ int32x4_t sum = vdupq_n_s32(0);
+
+ for(unsigned i = 0; i < count; i += 8)
+ {
+  const int16x8_t s = vld1q_s16(&src[i]);
+  const int16x8_t t = vld1q_s16(&table[i]);
+
+  sum = vmlal_s16(sum, vget_low_s16(s), vget_low_s16(t));
+  sum = vmlal_s16(sum, vget_high_s16(s), vget_high_s16(t));
+ }
+
+ const int32x2_t half = vadd_s32(vget_low_s32(sum), vget_high_s32(sum));
+
+ return vget_lane_s32(vpadd_s32(half, half), 0);
+#endif
+}
+#endif
+
 static INLINE int32 Reverb4422(const int16 *src)
 {
+#if defined(__SSE2__) || defined(__ARM_NEON__) || defined(__ARM_NEON)
+ int32 out = ReverbDot(src, ResampTable4422, 40);
+#else
  int32 out = 0;	// 32-bits is adequate(it won't overflow)
 
  for(unsigned i = 0; i < 20; i++)
@@ -615,6 +922,7 @@ static INLINE int32 Reverb4422(const int16 *src)
 
  // Middle non-zero
  out += 0x4000 * src[19];
+#endif
 
  out >>= 15;
 
@@ -625,11 +933,15 @@ static INLINE int32 Reverb4422(const int16 *src)
 
 static INLINE int32 Reverb2244(const int16 *src)
 {
+#if defined(__SSE2__) || defined(__ARM_NEON__) || defined(__ARM_NEON)
+   int32_t out = ReverbDot(src, ResampTable2244, 24);
+#else
    unsigned i;
    int32_t out = 0; /* 32bits is adequate (it won't overflow) */
 
    for(i = 0; i < 20; i++)
    out += ResampTable[i] * src[i];
+#endif
 
    out >>= 14;
 
@@ -650,9 +962,114 @@ static int32 IIASM(const int16 IIR_ALPHA, const int16 insamp)
    return insamp * (32768 - IIR_ALPHA);
 }
 
+//
+// The same-side and different-side reflection filters, lanes A0, A1, B0, B1.
+//
+static INLINE void ReverbIIR(const int16 *src, const int16 *prev, const int32 *downsampled,
+      int16 IIR_COEF, int16 IIR_ALPHA, int16 IN_COEF_L, int16 IN_COEF_R, int16 *iir)
+{
+#if defined(__SSE2__)
+ if(MDFN_LIKELY(IIR_ALPHA != -32768))
+ {
+  // 16x16->32 products of the low four lanes.
+  #define MUL32(a, b) _mm_unpacklo_epi16(_mm_mullo_epi16(a, b), _mm_mulhi_epi16(a, b))
+  const __m128i alpha = _mm_set1_epi16(IIR_ALPHA);
+  const __m128i s = _mm_loadl_epi64((const __m128i*)src);
+  const __m128i p = _mm_loadl_epi64((const __m128i*)prev);
+  const __m128i ds = _mm_packs_epi32(_mm_set_epi32(downsampled[1], downsampled[0], downsampled[1], downsampled[0]), _mm_setzero_si128());
+  __m128i input, iiasm, r;
+
+  input = _mm_add_epi32(_mm_srai_epi32(MUL32(s, _mm_set1_epi16(IIR_COEF)), 15),
+        _mm_srai_epi32(MUL32(ds, _mm_set_epi16(0, 0, 0, 0, IN_COEF_R, IN_COEF_L, IN_COEF_R, IN_COEF_L)), 15));
+  input = _mm_packs_epi32(input, input);
+
+  // IIASM(): prev * (32768 - IIR_ALPHA), which can't overflow here.
+  iiasm = _mm_sub_epi32(_mm_slli_epi32(_mm_srai_epi32(_mm_unpacklo_epi16(p, p), 16), 15), MUL32(p, alpha));
+
+  r = _mm_srai_epi32(_mm_add_epi32(_mm_srai_epi32(MUL32(input, alpha), 14), _mm_srai_epi32(iiasm, 14)), 1);
+  _mm_storel_epi64((__m128i*)iir, _mm_packs_epi32(r, r));
+  #undef MUL32
+  return;
+ }
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+ if(MDFN_LIKELY(IIR_ALPHA != -32768))
+ {
+  const int16 ds_tmp[4] = { (int16)downsampled[0], (int16)downsampled[1], (int16)downsampled[0], (int16)downsampled[1] };
+  const int16 in_coef_tmp[4] = { IN_COEF_L, IN_COEF_R, IN_COEF_L, IN_COEF_R };
+  const int16x4_t alpha = vdup_n_s16(IIR_ALPHA);
+  const int16x4_t p = vld1_s16(prev);
+  int16x4_t input;
+  int32x4_t iiasm, r;
+
+  input = vqmovn_s32(vaddq_s32(vshrq_n_s32(vmull_s16(vld1_s16(src), vdup_n_s16(IIR_COEF)), 15),
+           vshrq_n_s32(vmull_s16(vld1_s16(ds_tmp), vld1_s16(in_coef_tmp)), 15)));
+
+  // IIASM(): prev * (32768 - IIR_ALPHA), which can't overflow here.
+  iiasm = vsubq_s32(vshll_n_s16(p, 15), vmull_s16(p, alpha));
+
+  r = vshrq_n_s32(vaddq_s32(vshrq_n_s32(vmull_s16(input, alpha), 14), vshrq_n_s32(iiasm, 14)), 1);
+  vst1_s16(iir, vqmovn_s32(r));
+  return;
+ }
+#endif
+
+ for(unsigned i = 0; i < 4; i++)
+ {
+  const int16 input = ReverbSat(((src[i] * IIR_COEF) >> 15) + ((downsampled[i & 1] * ((i & 1) ? IN_COEF_R : IN_COEF_L)) >> 15));
+
+  iir[i] = ReverbSat((((input * IIR_ALPHA) >> 14) + (IIASM(IIR_ALPHA, prev[i]) >> 14)) >> 1);
+ }
+}
+
+//
+// The comb filters, src in A0, A1, B0, B1, C0, C1, D0, D1 order.
+//
+static INLINE void ReverbComb(const int16 *src, int16 ACC_COEF_A, int16 ACC_COEF_B, int16 ACC_COEF_C, int16 ACC_COEF_D, int16 *acc)
+{
+#if defined(__SSE2__)
+ const __m128i s = _mm_loadu_si128((const __m128i*)src);
+ const __m128i c = _mm_set_epi16(ACC_COEF_D, ACC_COEF_D, ACC_COEF_C, ACC_COEF_C, ACC_COEF_B, ACC_COEF_B, ACC_COEF_A, ACC_COEF_A);
+ const __m128i lo = _mm_mullo_epi16(s, c);
+ const __m128i hi = _mm_mulhi_epi16(s, c);
+ __m128i sum;
+ uint32 packed;
+
+ // (A0 + C0, A1 + C1, B0 + D0, B1 + D1), then folded onto the low two lanes.
+ sum = _mm_add_epi32(_mm_srai_epi32(_mm_unpacklo_epi16(lo, hi), 14), _mm_srai_epi32(_mm_unpackhi_epi16(lo, hi), 14));
+ sum = _mm_srai_epi32(_mm_add_epi32(sum, _mm_srli_si128(sum, 8)), 1);
+ packed = _mm_cvtsi128_si32(_mm_packs_epi32(sum, sum));
+
+ acc[0] = (int16)packed;
+ acc[1] = (int16)(packed >> 16);
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+ const int16 coef_tmp[8] = { ACC_COEF_A, ACC_COEF_A, ACC_COEF_B, ACC_COEF_B, ACC_COEF_C, ACC_COEF_C, ACC_COEF_D, ACC_COEF_D };
+ const int16x8_t s = vld1q_s16(src);
+ const int16x8_t c = vld1q_s16(coef_tmp);
+ const int32x4_t sum = vaddq_s32(vshrq_n_s32(vmull_s16(vget_low_s16(s), vget_low_s16(c)), 14),
+       vshrq_n_s32(vmull_s16(vget_high_s16(s), vget_high_s16(c)), 14));
+ const int32x2_t r = vshr_n_s32(vadd_s32(vget_low_s32(sum), vget_high_s32(sum)), 1);
+ const int16x4_t packed = vqmovn_s32(vcombine_s32(r, r));
+
+ vst1_lane_s16(&acc[0], packed, 0);
+ vst1_lane_s16(&acc[1], packed, 1);
+#else
+ for(unsigned i = 0; i < 2; i++)
+ {
+  acc[i] = ReverbSat((((src[0 + i] * ACC_COEF_A) >> 14) +
+           ((src[2 + i] * ACC_COEF_B) >> 14) +
+           ((src[4 + i] * ACC_COEF_C) >> 14) +
+           ((src[6 + i] * ACC_COEF_D) >> 14)) >> 1);
+ }
+#endif
+}
+
 //
 // Take care to thoroughly test the reverb resampling code when modifying anything that uses RvbResPos.
 //
+// The work area is still accessed one sample pair at a time, interleaved with voice decoding and capture
+// writes the same way as on the real thing; only the filter and resampler arithmetic is batched across
+// channels and taps.
+//
 void PS_SPU::RunReverb(const int32* in, int32* out)
 {
    unsigned lr;
@@ -668,52 +1085,55 @@ void PS_SPU::RunReverb(const int32* in, int32* out)
 
  if(RvbResPos & 1)
  {
-  int32 downsampled[2];
-
-  for(unsigned lr = 0; lr < 2; lr++)
-   downsampled[lr] = Reverb4422(&RDSB[lr][(RvbResPos - 39) & 0x3F]);
-
   /* Run algorithm */
   if(SPUControl & 0x80)
   {
-   int16 ACC0, ACC1;
+   int32 downsampled[2];
+   int16 iir_src[4], iir_prev[4], iir[4];
+   int16 acc_src[8], ACC[2];
    int16 FB_A0, FB_A1, FB_B0, FB_B1;
 
-   int16 IIR_INPUT_A0 = ReverbSat(((RD_RVB(IIR_SRC_A0) * IIR_COEF) >> 15) + ((downsampled[0] * IN_COEF_L) >> 15));
-   int16 IIR_INPUT_A1 = ReverbSat(((RD_RVB(IIR_SRC_A1) * IIR_COEF) >> 15) + ((downsampled[1] * IN_COEF_R) >> 15));
-   int16 IIR_INPUT_B0 = ReverbSat(((RD_RVB(IIR_SRC_B0) * IIR_COEF) >> 15) + ((downsampled[0] * IN_COEF_L) >> 15));
-   int16 IIR_INPUT_B1 = ReverbSat(((RD_RVB(IIR_SRC_B1) * IIR_COEF) >> 15) + ((downsampled[1] * IN_COEF_R) >> 15));
+   for(unsigned lr = 0; lr < 2; lr++)
+    downsampled[lr] = Reverb4422(&RDSB[lr][(RvbResPos - 39) & 0x3F]);
 
-   int16 IIR_A0 = ReverbSat((((IIR_INPUT_A0 * IIR_ALPHA) >> 14) + (IIASM(IIR_ALPHA, RD_RVB(IIR_DEST_A0, -1)) >> 14)) >> 1);
-   int16 IIR_A1 = ReverbSat((((IIR_INPUT_A1 * IIR_ALPHA) >> 14) + (IIASM(IIR_ALPHA, RD_RVB(IIR_DEST_A1, -1)) >> 14)) >> 1);
-   int16 IIR_B0 = ReverbSat((((IIR_INPUT_B0 * IIR_ALPHA) >> 14) + (IIASM(IIR_ALPHA, RD_RVB(IIR_DEST_B0, -1)) >> 14)) >> 1);
-   int16 IIR_B1 = ReverbSat((((IIR_INPUT_B1 * IIR_ALPHA) >> 14) + (IIASM(IIR_ALPHA, RD_RVB(IIR_DEST_B1, -1)) >> 14)) >> 1);
+   iir_src[0] = RD_RVB(IIR_SRC_A0);
+   iir_src[1] = RD_RVB(IIR_SRC_A1);
+   iir_src[2] = RD_RVB(IIR_SRC_B0);
+   iir_src[3] = RD_RVB(IIR_SRC_B1);
 
-   WR_RVB(IIR_DEST_A0, IIR_A0);
-   WR_RVB(IIR_DEST_A1, IIR_A1);
-   WR_RVB(IIR_DEST_B0, IIR_B0);
-   WR_RVB(IIR_DEST_B1, IIR_B1);
+   iir_prev[0] = RD_RVB(IIR_DEST_A0, -1);
+   iir_prev[1] = RD_RVB(IIR_DEST_A1, -1);
+   iir_prev[2] = RD_RVB(IIR_DEST_B0, -1);
+   iir_prev[3] = RD_RVB(IIR_DEST_B1, -1);
 
-   ACC0 = ReverbSat((((RD_RVB(ACC_SRC_A0) * ACC_COEF_A) >> 14) +
-	   	     ((RD_RVB(ACC_SRC_B0) * ACC_COEF_B) >> 14) +
-	   	     ((RD_RVB(ACC_SRC_C0) * ACC_COEF_C) >> 14) +
-	   	     ((RD_RVB(ACC_SRC_D0) * ACC_COEF_D) >> 14)) >> 1);
+   ReverbIIR(iir_src, iir_prev, downsampled, IIR_COEF, IIR_ALPHA, IN_COEF_L, IN_COEF_R, iir);
 
-   ACC1 = ReverbSat((((RD_RVB(ACC_SRC_A1) * ACC_COEF_A) >> 14) +
-	   	     ((RD_RVB(ACC_SRC_B1) * ACC_COEF_B) >> 14) +
-	   	     ((RD_RVB(ACC_SRC_C1) * ACC_COEF_C) >> 14) +
-	   	     ((RD_RVB(ACC_SRC_D1) * ACC_COEF_D) >> 14)) >> 1);
+   WR_RVB(IIR_DEST_A0, iir[0]);
+   WR_RVB(IIR_DEST_A1, iir[1]);
+   WR_RVB(IIR_DEST_B0, iir[2]);
+   WR_RVB(IIR_DEST_B1, iir[3]);
+
+   acc_src[0] = RD_RVB(ACC_SRC_A0);
+   acc_src[1] = RD_RVB(ACC_SRC_A1);
+   acc_src[2] = RD_RVB(ACC_SRC_B0);
+   acc_src[3] = RD_RVB(ACC_SRC_B1);
+   acc_src[4] = RD_RVB(ACC_SRC_C0);
+   acc_src[5] = RD_RVB(ACC_SRC_C1);
+   acc_src[6] = RD_RVB(ACC_SRC_D0);
+   acc_src[7] = RD_RVB(ACC_SRC_D1);
+
+   ReverbComb(acc_src, ACC_COEF_A, ACC_COEF_B, ACC_COEF_C, ACC_COEF_D, ACC);
 
    FB_A0 = RD_RVB(MIX_DEST_A0 - FB_SRC_A);
    FB_A1 = RD_RVB(MIX_DEST_A1 - FB_SRC_A);
    FB_B0 = RD_RVB(MIX_DEST_B0 - FB_SRC_B);
    FB_B1 = RD_RVB(MIX_DEST_B1 - FB_SRC_B);
 
-   WR_RVB(MIX_DEST_A0, ReverbSat(ACC0 - ((FB_A0 * FB_ALPHA) >> 15)));
-   WR_RVB(MIX_DEST_A1, ReverbSat(ACC1 - ((FB_A1 * FB_ALPHA) >> 15)));
+   WR_RVB(MIX_DEST_A0, ReverbSat(ACC[0] - ((FB_A0 * FB_ALPHA) >> 15)));
+   WR_RVB(MIX_DEST_A1, ReverbSat(ACC[1] - ((FB_A1 * FB_ALPHA) >> 15)));
 
-   WR_RVB(MIX_DEST_B0, ReverbSat(((FB_ALPHA * ACC0) >> 15) - ((FB_A0 * (int16)(0x8000 ^ FB_ALPHA)) >> 15) - ((FB_B0 * FB_X) >> 15)));
-   WR_RVB(MIX_DEST_B1, ReverbSat(((FB_ALPHA * ACC1) >> 15) - ((FB_A1 * (int16)(0x8000 ^ FB_ALPHA)) >> 15) - ((FB_B1 * FB_X) >> 15)));
+   WR_RVB(MIX_DEST_B0, ReverbSat(((FB_ALPHA * ACC[0]) >> 15) - ((FB_A0 * (int16)(0x8000 ^ FB_ALPHA)) >> 15) - ((FB_B0 * FB_X) >> 15)));
+   WR_RVB(MIX_DEST_B1, ReverbSat(((FB_ALPHA * ACC[1]) >> 15) - ((FB_A1 * (int16)(0x8000 ^ FB_ALPHA)) >> 15) - ((FB_B1 * FB_X) >> 15)));
   }
 
   /* Get output samplesq */
@@ -730,7 +1150,7 @@ void PS_SPU::RunReverb(const int32* in, int32* out)
      upsampled[lr] = src[9]; /* Reverb 2244 (Middle non-zero */
   }
  }
- else
+ else if(ReverbVol[0] | ReverbVol[1])	// The output is only ever scaled by ReverbVol.
  {
   for(unsigned lr = 0; lr < 2; lr++)
   {
@@ -790,283 +1210,366 @@ int32 PS_SPU::UpdateFromCDC(int32 clocks)
 
    while(sample_clocks > 0)
    {
-      // xxx[0] = left, xxx[1] = right
-
-      // Accumulated sound output.
-      int32 accum[2];
-
-      // Accumulated sound output for reverb input
-      int32 accum_fv[2];
-
-      // Output of reverb processing.
-      int32 reverb[2];
-
-      // Final output.
-      int32 output[2];
-
-      accum[0]    = accum[1]    = 0;
-      accum_fv[0] = accum_fv[1] = 0;
-      reverb[0]   = reverb[1]   = 0;
-      output[0]   = output[1]   = 0;
-
-      const uint32 PhaseModCache = FM_Mode & ~ 1;
-      /*
-       **
-       ** 0x1F801DAE Notes and Conjecture:
-       **   -------------------------------------------------------------------------------------
-       **   |   15   14 | 13 | 12 | 11 | 10  | 9  | 8 |  7 |  6  | 5    4    3    2    1    0   |
-       **   |      ?    | *13| ?  | ba | *10 | wrr|rdr| df |  is |      c                       |
-       **   -------------------------------------------------------------------------------------
-       **
-       **	c - Appears to be delayed copy of lower 6 bits from 0x1F801DAA.
-       **
-       **     is - Interrupt asserted out status. (apparently not instantaneous status though...)
-       **
-       **     df - Related to (c & 0x30) == 0x20 or (c & 0x30) == 0x30, at least.
-       **          0 = DMA busy(FIFO not empty when in DMA write mode?)?
-       **	    1 = DMA ready?  Something to do with the FIFO?
-       **
-       **     rdr - Read(DMA read?) Ready?
-       **
-       **     wrr - Write(DMA write?) Ready?
-       **
-       **     *10 - Unknown.  Some sort of (FIFO?) busy status?(BIOS tests for this bit in places)
-       **
-       **     ba - Alternates between 0 and 1, even when SPUControl bit15 is 0; might be related to CD audio and voice 1 and 3 writing to SPU RAM.
-       **
-       **     *13 - Unknown, was set to 1 when testing with an SPU delay system reg value of 0x200921E1(test result might not be reliable, re-run).
-       */
-      SPUStatus = SPUControl & 0x3F;
-      SPUStatus |= IRQAsserted ? 0x40 : 0x00;
-
-      if(Regs[0xD6] == 0x4)	// TODO: Investigate more(case 0x2C in global regs r/w handler)
-         SPUStatus |= (CWA & 0x100) ? 0x800 : 0x000;
-
-      for(int voice_num = 0; voice_num < 24; voice_num++)
+      if(PendingSamples < SPU_MAX_PENDING && CanDefer())
+         PendingSamples++;
+      else
       {
-         SPU_Voice *voice = &Voices[voice_num];
-         int32 voice_pvs;
+         Sync();
+         RunSample(true);
+      }
 
-         voice->PreLRSample = 0;
+      sample_clocks--;
+   }
 
-         //PSX_WARNING("[SPU] Voice %d CurPhase=%08x, pitch=%04x, CurAddr=%08x", voice_num, voice->CurPhase, voice->Pitch, voice->CurAddr);
+   //assert(clock_divider < 768);
 
-         //
-         // Decode new samples if necessary.
-         //
-         RunDecoder(voice);
+   return clock_divider;
+}
 
+//
+// Samples are held back (and register and DMA writes journaled against the
+// sample they precede) for as long as generating them later can't be told
+// apart from generating them now: no SPU IRQ can become asserted, and no CD
+// audio is being consumed. Anything that observes the SPU calls Sync() first.
+//
+bool PS_SPU::CanDefer(void)
+{
+   if((SPUControl & 0x40) && !IRQAsserted)
+      return false;
 
-         //
-         //
-         //
-         int l, r;
+   if(CDC->AudioBuffer.ReadPos < CDC->AudioBuffer.Size)
+      return false;
 
-         if(Noise_Mode & (1 << voice_num))
-            voice_pvs = (int16)LFSR;
-         else
-         {
-            const int si = voice->DecodeReadPos;
-            const int pi = ((voice->CurPhase & 0xFFF) >> 4);
+   return true;
+}
 
-            voice_pvs = ((voice->DecodeBuffer[(si + 0) & 0x1F] * FIR_Table[pi][0]) +
-                  (voice->DecodeBuffer[(si + 1) & 0x1F] * FIR_Table[pi][1]) +
-                  (voice->DecodeBuffer[(si + 2) & 0x1F] * FIR_Table[pi][2]) +   
-                  (voice->DecodeBuffer[(si + 3) & 0x1F] * FIR_Table[pi][3])) >> 15;
-         }
+void PS_SPU::Sync(void)
+{
+   uint32 done = 0;
 
-         voice_pvs = (voice_pvs * (int16)voice->ADSR.EnvLevel) >> 15;
-         voice->PreLRSample = voice_pvs;
+   for(uint32 i = 0; i < JournalCount; i++)
+   {
+      const SPU_JournalEntry *entry = &Journal[i];
 
-         if(voice_num == 1 || voice_num == 3)
-         {
-            int index = voice_num >> 1;
+      for(; done < entry->sample; done++)
+         RunSample(false);
 
-            WriteSPURAM(0x400 | (index * 0x200) | CWA, voice_pvs);
-         }
+      if(entry->A == SPU_JOURNAL_DMA)
+         WriteDMAWord(entry->V);
+      else
+         WriteReg(entry->A, entry->V);
+   }
 
+   for(; done < PendingSamples; done++)
+      RunSample(false);
 
-         l = (voice_pvs * voice->Sweep[0].ReadVolume()) >> 15;
-         r = (voice_pvs * voice->Sweep[1].ReadVolume()) >> 15;
+   JournalCount = 0;
+   PendingSamples = 0;
+}
 
-         accum[0] += l;
-         accum[1] += r;
+void PS_SPU::RunSample(bool cd_audio)
+{
+   // xxx[0] = left, xxx[1] = right
+
+   // Accumulated sound output.
+   int32 accum[2];
+
+   // Accumulated sound output for reverb input
+   int32 accum_fv[2];
+
+   // Output of reverb processing.
+   int32 reverb[2];
+
+   // Final output.
+   int32 output[2];
+
+   accum[0]    = accum[1]    = 0;
+   accum_fv[0] = accum_fv[1] = 0;
+   reverb[0]   = reverb[1]   = 0;
+   output[0]   = output[1]   = 0;
+
+   const uint32 PhaseModCache = FM_Mode & ~ 1;
+
+   SPU_MixState mix;
+   unsigned silent_voices;
+   /*
+    **
+    ** 0x1F801DAE Notes and Conjecture:
+    **   -------------------------------------------------------------------------------------
+    **   |   15   14 | 13 | 12 | 11 | 10  | 9  | 8 |  7 |  6  | 5    4    3    2    1    0   |
+    **   |      ?    | *13| ?  | ba | *10 | wrr|rdr| df |  is |      c                       |
+    **   -------------------------------------------------------------------------------------
+    **
+    **	c - Appears to be delayed copy of lower 6 bits from 0x1F801DAA.
+    **
+    **     is - Interrupt asserted out status. (apparently not instantaneous status though...)
+    **
+    **     df - Related to (c & 0x30) == 0x20 or (c & 0x30) == 0x30, at least.
+    **          0 = DMA busy(FIFO not empty when in DMA write mode?)?
+    **	    1 = DMA ready?  Something to do with the FIFO?
+    **
+    **     rdr - Read(DMA read?) Ready?
+    **
+    **     wrr - Write(DMA write?) Ready?
+    **
+    **     *10 - Unknown.  Some sort of (FIFO?) busy status?(BIOS tests for this bit in places)
+    **
+    **     ba - Alternates between 0 and 1, even when SPUControl bit15 is 0; might be related to CD audio and voice 1 and 3 writing to SPU RAM.
+    **
+    **     *13 - Unknown, was set to 1 when testing with an SPU delay system reg value of 0x200921E1(test result might not be reliable, re-run).
+    */
+   SPUStatus = SPUControl & 0x3F;
+   SPUStatus |= IRQAsserted ? 0x40 : 0x00;
+
+   if(Regs[0xD6] == 0x4)	// TODO: Investigate more(case 0x2C in global regs r/w handler)
+      SPUStatus |= (CWA & 0x100) ? 0x800 : 0x000;
+
+   // Decoding happens in voice order, as a voice may be playing back the
+   // area of SPU RAM that voices 1 and 3 write to.
+   mix.Wide = false;
+   silent_voices = 0;
+
+   for(int voice_num = 0; voice_num < 24; voice_num++)
+   {
+      SPU_Voice *voice = &Voices[voice_num];
+      // Nothing but key-on or a register write can raise the envelope of a released voice off 0, so such a
+      // voice contributes exactly 0 to the mix, to FM and to the capture buffers.  Only gathering its
+      // interpolation window is skipped: it's still decoded and enveloped every sample, and MixVoices() still
+      // runs over it unless all 24 voices are silent.
+      const bool silent = voice->ADSR.Phase == ADSR_RELEASE && voice->ADSR.EnvLevel == 0;
 
-         if(Reverb_Mode & (1 << voice_num))
-         {
-            accum_fv[0] += l;
-            accum_fv[1] += r;
-         }
+      //PSX_WARNING("[SPU] Voice %d CurPhase=%08x, pitch=%04x, CurAddr=%08x", voice_num, voice->CurPhase, voice->Pitch, voice->CurAddr);
 
-         // Run sweep
-         for(int lr = 0; lr < 2; lr++)
-         {
-            if((voice->Sweep[lr].Control & 0x8000))
-               voice->Sweep[lr].Clock();
-            else
-               voice->Sweep[lr].Current = (voice->Sweep[lr].Control & 0x7FFF) << 1;
-         }
+      //
+      // Decode new samples if necessary.
+      //
+      RunDecoder(voice);
 
-         // Increment stuff
-         if(!voice->DecodePlayDelay)
-         {
-            unsigned phase_inc;
+      if(silent)
+      {
+         memset(mix.Window[voice_num], 0, sizeof(mix.Window[voice_num]));
+         memset(mix.FIR[voice_num], 0, sizeof(mix.FIR[voice_num]));
+         silent_voices++;
+      }
+      else if(Noise_Mode & (1 << voice_num))
+      {
+         mix.Window[voice_num][0] = mix.Window[voice_num][1] = (int16)LFSR;
+         mix.Window[voice_num][2] = mix.Window[voice_num][3] = 0;
+         memcpy(mix.FIR[voice_num], Noise_FIR, sizeof(Noise_FIR));
 
-            // Run enveloping
-            RunEnvelope(voice);
+         if(LFSR == 0x8000 && voice->ADSR.EnvLevel == 0x8000)
+            mix.Wide = true;
+      }
+      else
+      {
+         const int si = voice->DecodeReadPos;
+         const int pi = ((voice->CurPhase & 0xFFF) >> 4);
 
-            if(PhaseModCache & (1 << voice_num))
-            {
-               // This old formula: phase_inc = (voice->Pitch * ((voice - 1)->PreLRSample + 0x8000)) >> 15;
-               // is incorrect, as it does not handle carrier pitches >= 0x8000 properly.
-               phase_inc = voice->Pitch + (((int16)voice->Pitch * ((voice - 1)->PreLRSample)) >> 15);
-            }
-            else
-               phase_inc = voice->Pitch;
+         for(unsigned i = 0; i < 4; i++)
+            mix.Window[voice_num][i] = voice->DecodeBuffer[(si + i) & 0x1F];
+         memcpy(mix.FIR[voice_num], FIR_Table[pi], sizeof(FIR_Table[pi]));
+      }
 
-            if(phase_inc > 0x3FFF)
-               phase_inc = 0x3FFF;
+      mix.Env[voice_num]    = (int16)voice->ADSR.EnvLevel;
+      mix.Vol[0][voice_num] = voice->Sweep[0].ReadVolume();
+      mix.Vol[1][voice_num] = voice->Sweep[1].ReadVolume();
 
-            {
-               const uint32 tmp_phase = voice->CurPhase + phase_inc;
-               const unsigned used = tmp_phase >> 12;
+      if(voice_num == 1 || voice_num == 3)
+      {
+         int index = voice_num >> 1;
 
-               voice->CurPhase = tmp_phase & 0xFFF;
-               voice->DecodeAvail -= used;
-               voice->DecodeReadPos = (voice->DecodeReadPos + used) & 0x1F;
-            }
-         }
-         else
-            voice->DecodePlayDelay--;
+         WriteSPURAM(0x400 | (index * 0x200) | CWA, silent ? 0 : MixVoice(&mix, voice_num));
+      }
+   }
 
-         if(VoiceOff & (1U << voice_num))
-         {
-            if(voice->ADSR.Phase != ADSR_RELEASE)
-            {
-               ReleaseEnvelope(voice);
-            }
-         }
+   if(silent_voices == 24)
+      memset(mix.PreLRSample, 0, sizeof(mix.PreLRSample));
+   else
+      MixVoices(&mix, Reverb_Mode, accum, accum_fv);
 
-         if(VoiceOn & (1U << voice_num))
-         {
-            //printf("Voice On: %u\n", voice_num);
+   for(int voice_num = 0; voice_num < 24; voice_num++)
+   {
+      SPU_Voice *voice = &Voices[voice_num];
 
-            ResetEnvelope(voice);
+      voice->PreLRSample = mix.PreLRSample[voice_num];
 
-            voice->DecodeFlags = 0;
-            voice->DecodeWritePos = 0;
-            voice->DecodeReadPos = 0;
-            voice->DecodeAvail = 0;
-            voice->DecodePlayDelay = 4;
+      // Run sweep
+      for(int lr = 0; lr < 2; lr++)
+      {
+         if((voice->Sweep[lr].Control & 0x8000))
+            voice->Sweep[lr].Clock();
+         else
+            voice->Sweep[lr].Current = (voice->Sweep[lr].Control & 0x7FFF) << 1;
+      }
 
-            BlockEnd &= ~(1 << voice_num);
+      // Increment stuff
+      if(!voice->DecodePlayDelay)
+      {
+         unsigned phase_inc;
 
-            //
-            // Weight/filter previous value initialization:
-            //
-            voice->DecodeM2 = 0;
-            voice->DecodeM1 = 0;
+         // Run enveloping
+         RunEnvelope(voice);
 
-            voice->CurPhase = 0;
-            voice->CurAddr = voice->StartAddr & ~0x7;
-            voice->IgnoreSampLA = false;
+         if(PhaseModCache & (1 << voice_num))
+         {
+            // This old formula: phase_inc = (voice->Pitch * ((voice - 1)->PreLRSample + 0x8000)) >> 15;
+            // is incorrect, as it does not handle carrier pitches >= 0x8000 properly.
+            phase_inc = voice->Pitch + (((int16)voice->Pitch * ((voice - 1)->PreLRSample)) >> 15);
          }
+         else
+            phase_inc = voice->Pitch;
+
+         if(phase_inc > 0x3FFF)
+            phase_inc = 0x3FFF;
 
-         if(!(SPUControl & 0x8000))
          {
-            voice->ADSR.Phase = ADSR_RELEASE;
-            voice->ADSR.EnvLevel = 0;
+            const uint32 tmp_phase = voice->CurPhase + phase_inc;
+            const unsigned used = tmp_phase >> 12;
+
+            voice->CurPhase = tmp_phase & 0xFFF;
+            voice->DecodeAvail -= used;
+            voice->DecodeReadPos = (voice->DecodeReadPos + used) & 0x1F;
          }
       }
+      else
+         voice->DecodePlayDelay--;
 
-      VoiceOff = 0;
-      VoiceOn = 0; 
-
-      // "Mute" control doesn't seem to affect CD audio(though CD audio reverb wasn't tested...)
-      // TODO: If we add sub-sample timing accuracy, see if it's checked for every channel at different times, or just once.
-      if(!(SPUControl & 0x4000))
+      if(VoiceOff & (1U << voice_num))
       {
-         accum[0] = 0;
-         accum[1] = 0;
-         accum_fv[0] = 0;
-         accum_fv[1] = 0;
+         if(voice->ADSR.Phase != ADSR_RELEASE)
+         {
+            ReleaseEnvelope(voice);
+         }
       }
 
-      // Get CD-DA
+      if(VoiceOn & (1U << voice_num))
       {
-         int32 cda_raw[2];
-         int32 cdav[2];
-         const unsigned freq = (CDC->AudioBuffer.ReadPos < CDC->AudioBuffer.Size) ? CDC->AudioBuffer.Freq : 0;
+         //printf("Voice On: %u\n", voice_num);
 
-         cda_raw[0] = cda_raw[1] = 0;
+         ResetEnvelope(voice);
 
-         if (freq)
-            CDC->GetCDAudio(cda_raw, freq);	// PS_CDC::GetCDAudio() guarantees the variables passed by reference will be set to 0,
-         // and that their range shall be -32768 through 32767.
+         voice->DecodeFlags = 0;
+         voice->DecodeWritePos = 0;
+         voice->DecodeReadPos = 0;
+         voice->DecodeAvail = 0;
+         voice->DecodePlayDelay = 4;
 
-         WriteSPURAM(CWA | 0x000, cda_raw[0]);
-         WriteSPURAM(CWA | 0x200, cda_raw[1]);
+         BlockEnd &= ~(1 << voice_num);
 
-         for(unsigned i = 0; i < 2; i++)
-            cdav[i] = (cda_raw[i] * CDVol[i]) >> 15;
+         //
+         // Weight/filter previous value initialization:
+         //
+         voice->DecodeM2 = 0;
+         voice->DecodeM1 = 0;
 
-         if(SPUControl & 0x0001)
-         {
-            accum[0] += cdav[0];
-            accum[1] += cdav[1];
+         voice->CurPhase = 0;
+         voice->CurAddr = voice->StartAddr & ~0x7;
+         voice->IgnoreSampLA = false;
+      }
 
-            if(SPUControl & 0x0004)	// TODO: Test this bit(and see if it is really dependent on bit0)
-            {
-               accum_fv[0] += cdav[0];
-               accum_fv[1] += cdav[1];
-            }
-         }
+      if(!(SPUControl & 0x8000))
+      {
+         voice->ADSR.Phase = ADSR_RELEASE;
+         voice->ADSR.EnvLevel = 0;
       }
+   }
 
-      CWA = (CWA + 1) & 0x1FF;
+   VoiceOff = 0;
+   VoiceOn = 0; 
 
-      RunNoise();
+   // "Mute" control doesn't seem to affect CD audio(though CD audio reverb wasn't tested...)
+   // TODO: If we add sub-sample timing accuracy, see if it's checked for every channel at different times, or just once.
+   if(!(SPUControl & 0x4000))
+   {
+      accum[0] = 0;
+      accum[1] = 0;
+      accum_fv[0] = 0;
+      accum_fv[1] = 0;
+   }
 
-      for (unsigned lr = 0; lr < 2; lr++)
-         clamp(&accum_fv[lr], -32768, 32767);
+   // Get CD-DA
+   {
+      int32 cda_raw[2];
+      int32 cdav[2];
+      const unsigned freq = (cd_audio && CDC->AudioBuffer.ReadPos < CDC->AudioBuffer.Size) ? CDC->AudioBuffer.Freq : 0;
 
-      RunReverb(accum_fv, reverb);
+      cda_raw[0] = cda_raw[1] = 0;
 
-      for(unsigned lr = 0; lr < 2; lr++)
-      {
-         accum[lr] += ((reverb[lr] * ReverbVol[lr]) >> 15);
-         clamp(&accum[lr],  -32768, 32767);
-         output[lr] = (accum[lr] * GlobalSweep[lr].ReadVolume()) >> 15;
-         clamp(&output[lr], -32768, 32767);
-      }
+      if (freq)
+         CDC->GetCDAudio(cda_raw, freq);	// PS_CDC::GetCDAudio() guarantees the variables passed by reference will be set to 0,
+      // and that their range shall be -32768 through 32767.
 
-      if(IntermediateBufferPos < 4096)	// Overflow might occur in some debugger use cases.
+      WriteSPURAM(CWA | 0x000, cda_raw[0]);
+      WriteSPURAM(CWA | 0x200, cda_raw[1]);
+
+      for(unsigned i = 0; i < 2; i++)
+         cdav[i] = (cda_raw[i] * CDVol[i]) >> 15;
+
+      if(SPUControl & 0x0001)
       {
-         // 75%, for some (resampling) headroom.
-         for(unsigned lr = 0; lr < 2; lr++)
-            IntermediateBuffer[IntermediateBufferPos][lr] = (output[lr] * 3 + 2) >> 2;
+         accum[0] += cdav[0];
+         accum[1] += cdav[1];
 
-         IntermediateBufferPos++;
+         if(SPUControl & 0x0004)	// TODO: Test this bit(and see if it is really dependent on bit0)
+         {
+            accum_fv[0] += cdav[0];
+            accum_fv[1] += cdav[1];
+         }
       }
+   }
 
-      sample_clocks--;
+   CWA = (CWA + 1) & 0x1FF;
 
-      // Clock global sweep
-      for(unsigned lr = 0; lr < 2; lr++)
-      {
-         if((GlobalSweep[lr].Control & 0x8000))
-            GlobalSweep[lr].Clock();
-         else
-            GlobalSweep[lr].Current = (GlobalSweep[lr].Control & 0x7FFF) << 1;
-      }
+   RunNoise();
+
+   for (unsigned lr = 0; lr < 2; lr++)
+      clamp(&accum_fv[lr], -32768, 32767);
+
+   RunReverb(accum_fv, reverb);
+
+   for(unsigned lr = 0; lr < 2; lr++)
+   {
+      accum[lr] += ((reverb[lr] * ReverbVol[lr]) >> 15);
+      clamp(&accum[lr],  -32768, 32767);
+      output[lr] = (accum[lr] * GlobalSweep[lr].ReadVolume()) >> 15;
+      clamp(&output[lr], -32768, 32767);
    }
 
-   //assert(clock_divider < 768);
+   if(IntermediateBufferPos < 4096)	// Overflow might occur in some debugger use cases.
+   {
+      // 75%, for some (resampling) headroom.  Left to the core's own resampler when it's in use.
+      for(unsigned lr = 0; lr < 2; lr++)
+         IntermediateBuffer[IntermediateBufferPos][lr] = IntermediateBufferHeadroom ? (output[lr] * 3 + 2) >> 2 : output[lr];
 
-   return clock_divider;
+      IntermediateBufferPos++;
+   }
+
+   // Clock global sweep
+   for(unsigned lr = 0; lr < 2; lr++)
+   {
+      if((GlobalSweep[lr].Control & 0x8000))
+         GlobalSweep[lr].Clock();
+      else
+         GlobalSweep[lr].Current = (GlobalSweep[lr].Control & 0x7FFF) << 1;
+   }
 }
 
 void PS_SPU::WriteDMA(uint32 V)
+{
+   if(PendingSamples && JournalCount < SPU_JOURNAL_SIZE)
+   {
+      Journal[JournalCount].sample = PendingSamples;
+      Journal[JournalCount].A = SPU_JOURNAL_DMA;
+      Journal[JournalCount].V = V;
+      JournalCount++;
+      return;
+   }
+
+   Sync();
+   WriteDMAWord(V);
+}
+
+void PS_SPU::WriteDMAWord(uint32 V)
 {
    //SPUIRQ_DBG("DMA Write, RWAddr after=0x%06x", RWAddr);
    WriteSPURAM(RWAddr, V);
@@ -1081,7 +1584,11 @@ void PS_SPU::WriteDMA(uint32 V)
 
 uint32 PS_SPU::ReadDMA(void)
 {
-   uint32 ret = (uint16)ReadSPURAM(RWAddr);
+   uint32 ret;
+
+   Sync();
+
+   ret = (uint16)ReadSPURAM(RWAddr);
    RWAddr = (RWAddr + 1) & 0x3FFFF;
 
    ret |= (uint32)(uint16)ReadSPURAM(RWAddr) << 16;
@@ -1101,6 +1608,22 @@ void PS_SPU::Write(int32_t timestamp, uint32 A, uint16 V)
 
    A &= 0x3FF;
 
+   // SPU control decides whether samples may be held back, so it's never journaled.
+   if(PendingSamples && A != 0x1AA && JournalCount < SPU_JOURNAL_SIZE)
+   {
+      Journal[JournalCount].sample = PendingSamples;
+      Journal[JournalCount].A = A;
+      Journal[JournalCount].V = V;
+      JournalCount++;
+      return;
+   }
+
+   Sync();
+   WriteReg(A, V);
+}
+
+void PS_SPU::WriteReg(uint32 A, uint16 V)
+{
    if(A >= 0x200)
    {
       //printf("Write: %08x %04x\n", A, V);
@@ -1282,6 +1805,8 @@ void PS_SPU::Write(int32_t timestamp, uint32 A, uint16 V)
 
 uint16 PS_SPU::Read(int32_t timestamp, uint32 A)
 {
+   Sync();
+
    A &= 0x3FF;
 
    PSX_DBGINFO("[SPU] Read: %08x", A);
@@ -1355,6 +1880,8 @@ uint16 PS_SPU::Read(int32_t timestamp, uint32 A)
 
 int PS_SPU::StateAction(StateMem *sm, int load, int data_only)
 {
+   Sync();
+
    SFORMAT StateRegs[] =
    {
 #define SFSWEEP(r) SFVAR((r).Control),	\
@@ -1483,6 +2010,8 @@ int PS_SPU::StateAction(StateMem *sm, int load, int data_only)
    {
       for(unsigned i = 0; i < 24; i++)
       {
+         Voices[i].DecodeCache = NULL;
+
          Voices[i].DecodeReadPos &= 0x1F;
          Voices[i].DecodeWritePos &= 0x1F;
          Voices[i].CurAddr &= 0x3FFFF;
@@ -1509,16 +2038,20 @@ int PS_SPU::StateAction(StateMem *sm, int load, int data_only)
 
 uint16 PS_SPU::PeekSPURAM(uint32 address)
 {
+   Sync();
    return(SPURAM[address & 0x3FFFF]);
 }
 
 void PS_SPU::PokeSPURAM(uint32 address, uint16 value)
 {
+   Sync();
    SPURAM[address & 0x3FFFF] = value;
 }
 
 uint32 PS_SPU::GetRegister(unsigned int which, char *special, const uint32 special_len)
 {
+   Sync();
+
    if(which >= 0x8000)
    {
       unsigned int v = (which - 0x8000) >> 8;
@@ -1594,6 +2127,8 @@ uint32 PS_SPU::GetRegister(unsigned int which, char *special, const uint32 speci
 
 void PS_SPU::SetRegister(unsigned int which, uint32 value)
 {
+   Sync();
+
    if(which >= GSREG_FB_SRC_A && which <= GSREG_IN_COEF_R)
       ReverbRegs[which - GSREG_FB_SRC_A] = value;
    else switch(which)
@@ -3,6 +3,7 @@
 
 extern uint32_t IntermediateBufferPos;
 extern int16_t IntermediateBuffer[4096][2];
+extern bool IntermediateBufferHeadroom;
 
 enum
 {
@@ -58,6 +59,22 @@ class SPU_Sweep
    uint32_t Divider;
 };
 
+// 28 decoded samples of an ADPCM block, keyed by the block's address, its
+// shift/weight and the filter history going in.  Words[] holds the SPU RAM
+// words they were decoded from and is compared on every use, so nothing that
+// writes SPU RAM ever has to invalidate an entry.
+struct SPU_DecodeCacheEntry
+{
+   uint32_t Tag;	// 0 = unused
+   uint32_t Addr;
+   uint8_t Header;
+   uint8_t Count;	// Words decoded so far
+   int16 M2;
+   int16 M1;
+   uint16_t Words[7];
+   int16 Samples[28];
+};
+
 struct SPU_Voice
 {
    int16 DecodeBuffer[0x20];
@@ -91,6 +108,30 @@ struct SPU_Voice
    int32_t PreLRSample;	// After enveloping, but before L/R volume.  Range of -32768 to 32767
 
    SPU_ADSR ADSR;
+
+   // Cache entry for the block being decoded, NULL if none; only valid while its Tag is DecodeCacheTag.
+   SPU_DecodeCacheEntry *DecodeCache;
+   uint32_t DecodeCacheTag;
+   uint8_t DecodeCacheMatched;	// Words of the block so far that matched, in order, what DecodeCache holds
+};
+
+// A register (or, for SPU_JOURNAL_DMA, DMA) write made while samples were
+// being held back, applied right before the sample it preceded.
+struct SPU_JournalEntry
+{
+   uint32_t sample;
+   uint32_t A;
+   uint32_t V;
+};
+
+enum
+{
+   SPU_JOURNAL_SIZE = 1024,
+   SPU_JOURNAL_DMA = 0xFFFFFFFF,
+
+   SPU_MAX_PENDING = 1024,
+
+   SPU_DECODE_CACHE_BITS = 10
 };
 
 class PS_SPU
@@ -111,8 +152,16 @@ class PS_SPU
 
       int32_t UpdateFromCDC(int32_t clocks);
 
+      // Generates any samples still being held back
+      void Sync(void);
+
    private:
 
+      bool CanDefer(void);
+      void RunSample(bool cd_audio);
+      void WriteReg(uint32_t A, uint16_t V);
+      void WriteDMAWord(uint32_t V);
+
       void CheckIRQAddr(uint32_t addr);
       void WriteSPURAM(uint32_t addr, uint16_t value);
       uint16_t ReadSPURAM(uint32_t addr);
@@ -241,6 +290,16 @@ class PS_SPU
       int last_rate;
       uint32_t last_quality;
 
+      SPU_JournalEntry Journal[SPU_JOURNAL_SIZE];
+      uint32_t JournalCount;
+      uint32_t PendingSamples;
+
+      void ResetDecodeCache(void);
+      void LookupDecodeCache(SPU_Voice *voice, uint32_t addr, uint8_t header);
+
+      SPU_DecodeCacheEntry DecodeCache[1 << SPU_DECODE_CACHE_BITS];
+      uint32_t DecodeCacheNextTag;
+
    public:
       enum
       {
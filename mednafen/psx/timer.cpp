@@ -329,6 +329,11 @@ void MDFN_FASTCALL TIMER_SetHRetrace(bool status)
    hretrace = status;
 }
 
+bool TIMER_FollowsGPULines(void)
+{
+   return (Timers[0].Mode & 0x101) || (Timers[1].Mode & 0x100);
+}
+
 void MDFN_FASTCALL TIMER_AddDotClocks(uint32_t count)
 {
    if(Timers[0].Mode & 0x100)
@@ -30,6 +30,10 @@ void TIMER_ClockHRetrace(void);
 void MDFN_FASTCALL TIMER_SetHRetrace(bool status);
 void MDFN_FASTCALL TIMER_SetVBlank(bool status);
 
+/* Whether a counter is clocked by the dot clock or hblank, or
+ * synchronized to hblank, so it needs to see every GPU line. */
+bool TIMER_FollowsGPULines(void);
+
 int32_t MDFN_FASTCALL TIMER_Update(const int32_t);
 void TIMER_ResetTS(void);
 
@@ -18,6 +18,8 @@
 #include "../mednafen.h"
 #include "surface.h"
 
+#include <algorithm>
+
 MDFN_PixelFormat::MDFN_PixelFormat()
 {
    bpp = 0;
@@ -29,9 +31,9 @@ MDFN_PixelFormat::MDFN_PixelFormat()
    Ashift = 0;
 }
 
-MDFN_PixelFormat::MDFN_PixelFormat(const unsigned int p_colorspace, const uint8 p_rs, const uint8 p_gs, const uint8 p_bs, const uint8 p_as)
+MDFN_PixelFormat::MDFN_PixelFormat(const unsigned int p_colorspace, const uint8 p_rs, const uint8 p_gs, const uint8 p_bs, const uint8 p_as, const unsigned int p_bpp)
 {
-   bpp = 32;
+   bpp = p_bpp;
    colorspace = p_colorspace;
 
    Rshift = p_rs;
@@ -86,6 +88,37 @@ void MDFN_Surface::SetFormat(const MDFN_PixelFormat &nf, bool convert)
    format = nf;
 }
 
+bool MDFN_Surface::Grow(const uint32 p_width, const uint32 p_height)
+{
+   const uint32 new_w     = std::max<uint32>(w, p_width);
+   const uint32 new_h     = std::max<uint32>(h, p_height);
+   const uint32 new_pitch = (new_w + 15) & ~15;
+   const uint32 bypp      = format.bpp / 8;
+   uint8 *rpix;
+
+   if(new_w == (uint32)w && new_h == (uint32)h)
+      return true;
+
+   rpix = (uint8 *)calloc(1, new_pitch * new_h * bypp);
+   if(!rpix)
+      return false;
+
+   if(pixels)
+   {
+      for(int32 y = 0; y < h; y++)
+         memcpy(rpix + y * new_pitch * bypp, (uint8 *)pixels + y * pitchinpix * bypp, w * bypp);
+
+      free(pixels);
+   }
+
+   pixels     = (uint32 *)rpix;
+   w          = new_w;
+   h          = new_h;
+   pitchinpix = new_pitch;
+
+   return true;
+}
+
 MDFN_Surface::~MDFN_Surface()
 {
    if(pixels)
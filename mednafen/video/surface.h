@@ -1,12 +1,45 @@
 #ifndef __MDFN_SURFACE_H
 #define __MDFN_SURFACE_H
 
+#if defined(WANT_16BPP)
+// RGB565, handed to the frontend as is. There is no alpha channel, MAKECOLOR
+// takes 8-bit components and drops the low bits.
+#define RED_SHIFT 11
+#define GREEN_SHIFT 5
+#define BLUE_SHIFT 0
+#define ALPHA_SHIFT 16
+#define MAKECOLOR(r, g, b, a) ((((r) >> 3) << RED_SHIFT) | (((g) >> 2) << GREEN_SHIFT) | (((b) >> 3) << BLUE_SHIFT))
+
+typedef uint16 MDFN_SurfacePixel;
+#else
 #define RED_SHIFT 16
 #define GREEN_SHIFT 8
 #define BLUE_SHIFT 0
 #define ALPHA_SHIFT 24
 #define MAKECOLOR(r, g, b, a) ((r << RED_SHIFT) | (g << GREEN_SHIFT) | (b << BLUE_SHIFT) | (a << ALPHA_SHIFT))
 
+typedef uint32 MDFN_SurfacePixel;
+#endif
+
+// Gets the 8-bit R/G/B/A values of a surface pixel value
+static INLINE void MDFN_DecodeSurfaceColor(uint32 value, int &r, int &g, int &b, int &a)
+{
+#if defined(WANT_16BPP)
+   r = (value >> RED_SHIFT) & 0x1F;
+   g = (value >> GREEN_SHIFT) & 0x3F;
+   b = (value >> BLUE_SHIFT) & 0x1F;
+   r = (r << 3) | (r >> 2);
+   g = (g << 2) | (g >> 4);
+   b = (b << 3) | (b >> 2);
+   a = 0;
+#else
+   r = (value >> RED_SHIFT) & 0xFF;
+   g = (value >> GREEN_SHIFT) & 0xFF;
+   b = (value >> BLUE_SHIFT) & 0xFF;
+   a = (value >> ALPHA_SHIFT) & 0xFF;
+#endif
+}
+
 struct MDFN_PaletteEntry
 {
  uint8 r, g, b;
@@ -29,7 +62,7 @@ class MDFN_PixelFormat
  public:
 
  MDFN_PixelFormat();
- MDFN_PixelFormat(const unsigned int p_colorspace, const uint8 p_rs, const uint8 p_gs, const uint8 p_bs, const uint8 p_as);
+ MDFN_PixelFormat(const unsigned int p_colorspace, const uint8 p_rs, const uint8 p_gs, const uint8 p_bs, const uint8 p_as, const unsigned int p_bpp = 32);
 
  unsigned int bpp;
  unsigned int colorspace;
@@ -56,19 +89,15 @@ class MDFN_PixelFormat
 
  uint8 Ashift;  // [...] alpha component.
 
- // Gets the R/G/B/A values for the passed 32-bit surface pixel value
+ // Gets the R/G/B/A values for the passed surface pixel value
  INLINE void DecodeColor(uint32 value, int &r, int &g, int &b, int &a) const
  {
-    r = (value >> RED_SHIFT) & 0xFF;
-    g = (value >> GREEN_SHIFT) & 0xFF;
-    b = (value >> BLUE_SHIFT) & 0xFF;
-    a = (value >> ALPHA_SHIFT) & 0xFF;
+    MDFN_DecodeSurfaceColor(value, r, g, b, a);
  }
 
 }; // MDFN_PixelFormat;
 
-// Supports 32-bit RGBA
-//  16-bit is WIP
+// Supports 32-bit RGBA and, when built with WANT_16BPP, RGB565
 class MDFN_Surface //typedef struct
 {
  public:
@@ -78,7 +107,11 @@ class MDFN_Surface //typedef struct
 
  ~MDFN_Surface();
 
- uint32 *pixels;
+ union
+ {
+  uint32 *pixels;
+  uint16 *pixels16;
+ };
 
  // w, h, and pitch32 should always be > 0
  int32 w;
@@ -96,20 +129,20 @@ class MDFN_Surface //typedef struct
 
  void SetFormat(const MDFN_PixelFormat &new_format, bool convert);
 
- // Gets the R/G/B/A values for the passed 32-bit surface pixel value
+ // Enlarges the surface to at least p_width x p_height, keeping the current contents.
+ // The pitch is rounded up to a multiple of 16 pixels.
+ bool Grow(const uint32 p_width, const uint32 p_height);
+
+ // Gets the R/G/B/A values for the passed surface pixel value
  INLINE void DecodeColor(uint32 value, int &r, int &g, int &b, int &a) const
  {
-    r = (value >> RED_SHIFT) & 0xFF;
-    g = (value >> GREEN_SHIFT) & 0xFF;
-    b = (value >> BLUE_SHIFT) & 0xFF;
-    a = (value >> ALPHA_SHIFT) & 0xFF;
+    MDFN_DecodeSurfaceColor(value, r, g, b, a);
  }
 
  INLINE void DecodeColor(uint32 value, int &r, int &g, int &b) const
  {
-    r = (value >> RED_SHIFT) & 0xFF;
-    g = (value >> GREEN_SHIFT) & 0xFF;
-    b = (value >> BLUE_SHIFT) & 0xFF;
+    int a;
+    MDFN_DecodeSurfaceColor(value, r, g, b, a);
  }
  private:
  bool Init(void *const p_pixels, const uint32 p_width, const uint32 p_height, const uint32 p_pitchinpix, const MDFN_PixelFormat &nf);
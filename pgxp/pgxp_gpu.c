@@ -29,6 +29,7 @@
 #include "pgxp_value.h"
 
 #include <math.h>
+#include <stdlib.h>
 #include <string.h>
 #include <assert.h>
 
@@ -73,7 +74,23 @@ const unsigned int mode_write = 1;
 const unsigned int mode_read = 2;
 const unsigned int mode_fail = 3;
 
-PGXP_value vertexCache[0x800 * 2][0x800 * 2];
+// Sparse cache keyed by screen position. A flat array over the whole
+// 4096x4096 coordinate space is ~500MB for what is in practice a few
+// thousand live vertices, so entries live in an open-addressed hash table
+// that starts small and only grows with the working set.
+typedef struct
+{
+	u32			key;	// ((sy << 12) | sx) + 1 in 12 bit offset form, 0 if empty
+	u32			epoch;	// last epoch this entry was written or hit
+	PGXP_value	vertex;
+} VertexCacheEntry;
+
+#define VERTEX_CACHE_MIN_SIZE	4096	// entries, must be a power of two
+
+static VertexCacheEntry*	vertexCache = NULL;
+static u32					vertexCacheSize = 0;
+static u32					vertexCacheCount = 0;
+static u32					vertexCacheEpoch = 0;
 
 unsigned int baseID = 0;
 unsigned int lastID = 0;
@@ -96,10 +113,129 @@ unsigned int IsSessionID(unsigned int vertID)
 	return 0;
 }
 
+static u32 VertexCacheKey(short sx, short sy)
+{
+	return ((u32)(sy + 0x800) << 12 | (u32)(sx + 0x800)) + 1;
+}
+
+static u32 VertexCacheHash(u32 key)
+{
+	key *= 0x9E3779B1;
+	return key ^ (key >> 16);
+}
+
+static VertexCacheEntry* VertexCacheFind(u32 key)
+{
+	u32 mask, i;
+
+	if (!vertexCache)
+		return NULL;
+
+	mask = vertexCacheSize - 1;
+	i = VertexCacheHash(key) & mask;
+
+	// Never full, see VertexCacheInsert
+	while (vertexCache[i].key)
+	{
+		if (vertexCache[i].key == key)
+			return &vertexCache[i];
+		i = (i + 1) & mask;
+	}
+
+	return NULL;
+}
+
+// Rebuilds the table, dropping every entry that wasn't written or hit since
+// the previous rebuild, and doubles it if the survivors alone would still
+// leave it over half full.
+static void VertexCacheRehash(void)
+{
+	VertexCacheEntry*	oldCache = vertexCache;
+	u32					oldSize = vertexCacheSize;
+	u32					live = 0;
+	u32					newSize = vertexCacheSize ? vertexCacheSize : VERTEX_CACHE_MIN_SIZE;
+	u32					i;
+
+	for (i = 0; i < oldSize; i++)
+	{
+		if (oldCache[i].key && oldCache[i].epoch == vertexCacheEpoch)
+			live++;
+	}
+
+	while (live * 2 >= newSize)
+		newSize *= 2;
+
+	vertexCache = (VertexCacheEntry*)calloc(newSize, sizeof(VertexCacheEntry));
+	if (!vertexCache)
+	{
+		// Keep the old table (there's always a free slot left)
+		vertexCache = oldCache;
+		return;
+	}
+
+	vertexCacheSize = newSize;
+	vertexCacheCount = 0;
+
+	for (i = 0; i < oldSize; i++)
+	{
+		if (oldCache[i].key && oldCache[i].epoch == vertexCacheEpoch)
+		{
+			u32 j = VertexCacheHash(oldCache[i].key) & (newSize - 1);
+
+			while (vertexCache[j].key)
+				j = (j + 1) & (newSize - 1);
+
+			vertexCache[j] = oldCache[i];
+			vertexCacheCount++;
+		}
+	}
+
+	free(oldCache);
+
+	// Survivors have to be touched again to outlive the next rebuild
+	vertexCacheEpoch++;
+}
+
+static VertexCacheEntry* VertexCacheInsert(u32 key)
+{
+	VertexCacheEntry* entry = VertexCacheFind(key);
+	u32 i;
+
+	if (entry)
+		return entry;
+
+	// Keep the load factor below 3/4 so probes stay short
+	if ((vertexCacheCount + 1) * 4 > vertexCacheSize * 3)
+	{
+		VertexCacheRehash();
+		if ((vertexCacheCount + 1) >= vertexCacheSize)
+			return NULL;
+	}
+
+	i = VertexCacheHash(key) & (vertexCacheSize - 1);
+	while (vertexCache[i].key)
+		i = (i + 1) & (vertexCacheSize - 1);
+
+	vertexCache[i].key = key;
+	vertexCacheCount++;
+
+	return &vertexCache[i];
+}
+
+void PGXP_InitGPU()
+{
+	free(vertexCache);
+	vertexCache = NULL;
+	vertexCacheSize = 0;
+	vertexCacheCount = 0;
+	vertexCacheEpoch = 0;
+	cacheMode = mode_init;
+}
+
 void PGXP_CacheVertex(short sx, short sy, const PGXP_value* _pVertex)
 {
 	const PGXP_value*	pNewVertex = (const PGXP_value*)_pVertex;
-	PGXP_value*		pOldVertex = NULL;
+	VertexCacheEntry*	pEntry = NULL;
 
 	if (!pNewVertex)
 	{
@@ -111,10 +247,6 @@ void PGXP_CacheVertex(short sx, short sy, const PGXP_value* _pVertex)
 	{
 		if (cacheMode != mode_write)
 		{
-			// Initialise cache on first use
-			if (cacheMode == mode_init)
-				memset(vertexCache, 0x00, sizeof(vertexCache));
-
 			// First vertex of write session (frame?)
 			cacheMode = mode_write;
 			baseID = pNewVertex->count;
@@ -125,25 +257,28 @@ void PGXP_CacheVertex(short sx, short sy, const PGXP_value* _pVertex)
 		if (sx >= -0x800 && sx <= 0x7ff &&
 			sy >= -0x800 && sy <= 0x7ff)
 		{
-			pOldVertex = &vertexCache[sy + 0x800][sx + 0x800];
+			pEntry = VertexCacheInsert(VertexCacheKey(sx, sy));
+			if (!pEntry)
+				return;
 
 			// To avoid ambiguity there can only be one valid entry per-session
-			if (0)//(IsSessionID(pOldVertex->count) && (pOldVertex->value == pNewVertex->value))
+			if (0)//(IsSessionID(pEntry->vertex.count) && (pEntry->vertex.value == pNewVertex->value))
 			{
 				// check to ensure this isn't identical
-				if ((fabsf(pOldVertex->x - pNewVertex->x) > 0.1f) ||
-					(fabsf(pOldVertex->y - pNewVertex->y) > 0.1f) ||
-					(fabsf(pOldVertex->z - pNewVertex->z) > 0.1f))
+				if ((fabsf(pEntry->vertex.x - pNewVertex->x) > 0.1f) ||
+					(fabsf(pEntry->vertex.y - pNewVertex->y) > 0.1f) ||
+					(fabsf(pEntry->vertex.z - pNewVertex->z) > 0.1f))
 				{
-					*pOldVertex = *pNewVertex;
-					pOldVertex->gFlags = 5;
+					pEntry->vertex = *pNewVertex;
+					pEntry->vertex.gFlags = 5;
 					return;
 				}
 			}
 
 			// Write vertex into cache
-			*pOldVertex = *pNewVertex;
-			pOldVertex->gFlags = 1;
+			pEntry->vertex = *pNewVertex;
+			pEntry->vertex.gFlags = 1;
+			pEntry->epoch = vertexCacheEpoch;
 		}
 	}
 }
@@ -157,10 +292,6 @@ PGXP_value* PGXP_GetCachedVertex(short sx, short sy)
 			if (cacheMode == mode_fail)
 				return NULL;
 
-			// Initialise cache on first use
-			if (cacheMode == mode_init)
-				memset(vertexCache, 0x00, sizeof(vertexCache));
-
 			// First vertex of read session (frame?)
 			cacheMode = mode_read;
 		}
@@ -168,8 +299,14 @@ PGXP_value* PGXP_GetCachedVertex(short sx, short sy)
 		if (sx >= -0x800 && sx <= 0x7ff &&
 			sy >= -0x800 && sy <= 0x7ff)
 		{
-			// Return pointer to cache entry
-			return &vertexCache[sy + 0x800][sx + 0x800];
+			// Return pointer to cache entry, valid until the next PGXP_CacheVertex
+			VertexCacheEntry* pEntry = VertexCacheFind(VertexCacheKey(sx, sy));
+
+			if (pEntry)
+			{
+				pEntry->epoch = vertexCacheEpoch;
+				return &pEntry->vertex;
+			}
 		}
 	}
 
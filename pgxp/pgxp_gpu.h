@@ -51,6 +51,8 @@ extern "C" {
 	void		PGXP_WriteCB(PGXP_value* pV, u32 pos);
 	PGXP_value*	PGXP_ReadCB(u32 pos);
 
+	void	PGXP_InitGPU();
+
 	void	PGXP_CacheVertex(short sx, short sy, const PGXP_value* _pVertex);
 
 	void	PGXP_SetAddress(unsigned int addr);
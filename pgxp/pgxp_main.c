@@ -2,6 +2,7 @@
 #include "pgxp_cpu.h"
 #include "pgxp_mem.h"
 #include "pgxp_gte.h"
+#include "pgxp_gpu.h"
 
 u32 static gMode = 0;
 
@@ -10,11 +11,15 @@ void PGXP_Init()
 	PGXP_InitMem();
 	PGXP_InitCPU();
 	PGXP_InitGTE();
+	PGXP_InitGPU();
 }
 
 void PGXP_SetModes(u32 modes)
 {
 	gMode = modes;
+
+	if (!(gMode & PGXP_MODE_MEMORY))
+		PGXP_FreeMem();
 }
 
 u32	PGXP_GetModes()
@@ -30,4 +35,7 @@ void PGXP_EnableModes(u32 modes)
 void PGXP_DisableModes(u32 modes)
 {
 	gMode = gMode & ~modes;
+
+	if (!(gMode & PGXP_MODE_MEMORY))
+		PGXP_FreeMem();
 }
@@ -1,3 +1,4 @@
+#include <stdlib.h>
 #include <string.h>
 
 #include "pgxp_mem.h"
@@ -5,20 +6,37 @@
 #include "pgxp_gte.h"
 #include "pgxp_value.h"
 
-PGXP_value Mem[3 * 2048 * 1024 / 4];		// mirror 2MB in 32-bit words * 3
+// Shadow of 2MB RAM, scratchpad and registers in 32-bit words, 3 * 2MB regions.
+// Pages of 4KB of PSX memory are only allocated once a PGXP write touches
+// them, so nothing is resident while PGXP is off and only the pages a game
+// actually stores geometry in once it's on.
+#define MEM_WORDS		(3 * 2048 * 1024 / 4)
+#define MEM_PAGE_SHIFT	10
+#define MEM_PAGE_WORDS	(1 << MEM_PAGE_SHIFT)
+#define MEM_PAGES		(MEM_WORDS >> MEM_PAGE_SHIFT)
+
+static PGXP_value*	MemPages[MEM_PAGES];
+static PGXP_value	MemZero;	// stands in for pages never written, read only
+
 const u32 UserMemOffset = 0;
 const u32 ScratchOffset = 2048 * 1024 / 4;
 const u32 RegisterOffset = 2 * 2048 * 1024 / 4;
-const u32 InvalidAddress = 3 * 2048 * 1024 / 4;
+const u32 InvalidAddress = MEM_WORDS;
 
-void PGXP_InitMem()
+void PGXP_FreeMem()
 {
-	memset(Mem, 0, sizeof(Mem));
+	u32 i;
+
+	for (i = 0; i < MEM_PAGES; i++)
+	{
+		free(MemPages[i]);
+		MemPages[i] = NULL;
+	}
 }
 
-char* PGXP_GetMem()
+void PGXP_InitMem()
 {
-	return (char*)(Mem); // Config.PGXP_GTE ? (char*)(Mem) : NULL;
+	PGXP_FreeMem();
 }
 
 /*  Playstation Memory Map (from Playstation doc by Joshua Walker)
@@ -107,26 +125,54 @@ u32 PGXP_ConvertAddress(u32 addr)
 	return paddr;
 }
 
+// Returns a writable shadow entry, allocating its page on first use
 PGXP_value* GetPtr(u32 addr)
 {
+	PGXP_value* page;
+
 	addr = PGXP_ConvertAddress(addr);
 
-	if (addr != InvalidAddress)
-		return &Mem[addr];
-	return NULL;
+	if (addr == InvalidAddress)
+		return NULL;
+
+	page = MemPages[addr >> MEM_PAGE_SHIFT];
+	if (!page)
+	{
+		page = (PGXP_value*)calloc(MEM_PAGE_WORDS, sizeof(PGXP_value));
+		if (!page)
+			return NULL;
+		MemPages[addr >> MEM_PAGE_SHIFT] = page;
+	}
+
+	return &page[addr & (MEM_PAGE_WORDS - 1)];
 }
 
+// Returns a shadow entry for reading only, entries of pages that were
+// never written all read back as zero (invalid)
 PGXP_value* ReadMem(u32 addr)
 {
-	return GetPtr(addr);
+	PGXP_value* page;
+
+	addr = PGXP_ConvertAddress(addr);
+
+	if (addr == InvalidAddress)
+		return NULL;
+
+	page = MemPages[addr >> MEM_PAGE_SHIFT];
+	if (!page)
+		return &MemZero;
+
+	return &page[addr & (MEM_PAGE_WORDS - 1)];
 }
 
 void ValidateAndCopyMem(PGXP_value* dest, u32 addr, u32 value)
 {
-	PGXP_value* pMem = GetPtr(addr);
+	PGXP_value* pMem = ReadMem(addr);
 	if (pMem != NULL)
 	{
-		Validate(pMem, value);
+		// Validating only ever clears flags, which are already clear in MemZero
+		if (pMem != &MemZero)
+			Validate(pMem, value);
 		*dest = *pMem;
 		return;
 	}
@@ -138,7 +184,7 @@ void ValidateAndCopyMem16(PGXP_value* dest, u32 addr, u32 value, int sign)
 {
 	u32 validMask = 0;
 	psx_value val, mask;
-	PGXP_value* pMem = GetPtr(addr);
+	PGXP_value* pMem = ReadMem(addr);
 	if (pMem != NULL)
 	{
 		mask.d = val.d = 0;
@@ -157,7 +203,8 @@ void ValidateAndCopyMem16(PGXP_value* dest, u32 addr, u32 value, int sign)
 		}
 
 		// validate and copy whole value
-		MaskValidate(pMem, val.d, mask.d, validMask);
+		if (pMem != &MemZero)
+			MaskValidate(pMem, val.d, mask.d, validMask);
 		*dest = *pMem;
 
 		// if high word then shift
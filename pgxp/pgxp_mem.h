@@ -36,8 +36,8 @@ extern "C" {
 #include "pgxp_types.h"
 
    void PGXP_InitMem(void);
+   void PGXP_FreeMem(void);	// release the shadow, it's rebuilt on demand
 
-   char*	PGXP_GetMem();	// return pointer to precision memory
    u32		PGXP_ConvertAddress(u32 addr);
 
    PGXP_value* GetPtr(u32 addr);
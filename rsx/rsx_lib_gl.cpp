@@ -328,6 +328,7 @@ static RetroGl static_renderer;
 static bool has_software_fb = false;
 
 extern "C" unsigned char widescreen_hack;
+extern "C" unsigned audio_output_rate;
 
 
 #ifdef __cplusplus
@@ -2021,7 +2022,7 @@ struct retro_system_av_info get_av_info(VideoClock std)
    if (display_vram)
       info.geometry.aspect_ratio = 2./1.;
 
-   info.timing.sample_rate     = SOUND_FREQUENCY;
+   info.timing.sample_rate     = audio_output_rate;
 
    /* Precise FPS values for the video output for the given
     * VideoClock. It's actually possible to configure the PlayStation GPU
@@ -18,7 +18,7 @@ void rsx_soft_get_system_av_info(struct retro_system_av_info *info)
 {
    memset(info, 0, sizeof(*info));
    info->timing.fps            = content_is_pal ? FPS_PAL : FPS_NTSC;
-   info->timing.sample_rate    = SOUND_FREQUENCY;
+   info->timing.sample_rate    = audio_output_rate;
    info->geometry.base_width   = MEDNAFEN_CORE_GEOMETRY_BASE_W;
    info->geometry.base_height  = MEDNAFEN_CORE_GEOMETRY_BASE_H;
    info->geometry.max_width    = MEDNAFEN_CORE_GEOMETRY_MAX_W  << psx_gpu_upscale_shift;
@@ -302,7 +302,7 @@ void rsx_vulkan_get_system_av_info(struct retro_system_av_info *info)
    info->geometry.base_height = MEDNAFEN_CORE_GEOMETRY_BASE_H;
    info->geometry.max_width   = MEDNAFEN_CORE_GEOMETRY_MAX_W * (super_sampling ? 1 : scaling);
    info->geometry.max_height  = MEDNAFEN_CORE_GEOMETRY_MAX_H * (super_sampling ? 1 : scaling);
-   info->timing.sample_rate   = SOUND_FREQUENCY;
+   info->timing.sample_rate   = audio_output_rate;
 
    info->geometry.aspect_ratio = !widescreen_hack ? MEDNAFEN_CORE_GEOMETRY_ASPECT_RATIO : 16.0 / 9.0;
    if (content_is_pal)
@@ -6,7 +6,7 @@ extern "C"
 {
 #endif
 
-/* bpp = bytes per pixel */
+/* bpp = bytes per pixel, 2 for RGB565 or 4 for XRGB8888 */
 void gui_init(int width, int height, int bpp);
 
 void gui_draw(void);
@@ -17,7 +17,7 @@ void gui_set_message(const char *message);
 
 void gui_window_resize(int x, int y, int width, int height);
 
-unsigned* gui_get_framebuffer(void);
+void* gui_get_framebuffer(void);
 
 #ifdef __cplusplus
 }